@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// A sequence kept in one array with a gap in it, at the place last
+// changed. Replacing items next to the gap moves only the items between
+// the gap and the change, so a run of changes in one place, like typing,
+// costs as much as the items changed and not as much as the sequence.
+template <class T> class GapBuffer {
+  public:
+    size_t size() const { return items_.size() - gapLength_; }
+    T &operator[](size_t i) { return items_[i < gapStart_ ? i : i + gapLength_]; }
+    const T &operator[](size_t i) const { return items_[i < gapStart_ ? i : i + gapLength_]; }
+
+    // replaces the count items from index with the n items from items
+    void replace(size_t index, size_t count, const T *items, size_t n) {
+        moveGap(index);
+        gapLength_ += count;
+        if (gapLength_ < n) grow(n);
+        std::copy(items, items + n, items_.begin() + gapStart_);
+        gapStart_ += n;
+        gapLength_ -= n;
+    }
+
+  private:
+    void moveGap(size_t index) {
+        auto items = items_.begin();
+        if (index < gapStart_) {
+            std::move_backward(items + index, items + gapStart_, items + gapStart_ + gapLength_);
+        } else {
+            std::move(items + gapStart_ + gapLength_, items + index + gapLength_, items + gapStart_);
+        }
+        gapStart_ = index;
+    }
+
+    // makes the gap at least n long, and then some for the changes after
+    void grow(size_t n) {
+        size_t length = std::max(n, size() / 8 + 256);
+        size_t after = items_.size() - gapStart_ - gapLength_;
+        items_.resize(gapStart_ + length + after);
+        std::move_backward(items_.begin() + gapStart_ + gapLength_, items_.begin() + gapStart_ + gapLength_ + after,
+                           items_.end());
+        gapLength_ = length;
+    }
+
+    std::vector<T> items_;
+    size_t gapStart_ = 0;
+    size_t gapLength_ = 0;
+};
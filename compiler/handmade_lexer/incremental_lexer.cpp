@@ -0,0 +1,117 @@
+#include "incremental_lexer.h"
+#include <ostream>
+#include <vector>
+
+IncrementalLexer::IncrementalLexer(std::string_view text) {
+    edit(text, 0, 0, text.size());
+}
+
+IncrementalLexer::Change IncrementalLexer::edit(std::string_view text, size_t offset, size_t removed, size_t inserted) {
+    text_ = text;
+    ptrdiff_t delta = (ptrdiff_t)inserted - (ptrdiff_t)removed;
+
+    // A token that ended before offset was lexed without looking at the
+    // edited bytes: lexing a token looks at most one byte past its end.
+    size_t first = firstEndingFrom(offset);
+    std::ostream discard(nullptr);
+    Lexer lexer(text, false, false, 1, discard);
+    Lexer::State state = before(first);
+    lexer.restore(state);
+
+    std::vector<Entry> lexed;
+    size_t next = first;
+    Lexer::State old;
+    bool synced = false;
+    for (;;) {
+        if (state.offset >= offset + inserted) {
+            // the old state nearest the same place in the text before the edit
+            while (next < entries_.size() && (ptrdiff_t)before(next).offset + delta < (ptrdiff_t)state.offset) {
+                next++;
+            }
+            old = before(next);
+            if (old.offset >= offset + removed && (ptrdiff_t)old.offset + delta == (ptrdiff_t)state.offset) {
+                synced = true;
+                break;
+            }
+        }
+        Token token = lexer.getToken();
+        if (token.type == TokenType::eof) break;
+        state = lexer.state();
+        lexed.push_back(Entry{token.type, token.line, token.col, (size_t)(token.val.data() - text.data()),
+                              token.val.size(), state});
+    }
+    if (!synced) next = entries_.size();
+
+    moveStep(next);
+    entries_.replace(first, next - first, lexed.data(), lexed.size());
+    stepIndex_ = first + lexed.size();
+    if (!synced) {
+        stepOffset_ = 0;
+        stepLines_ = 0;
+        return Change{first, next - first, lexed.size()};
+    }
+    stepOffset_ += delta;
+    stepLines_ += state.line - old.line;
+
+    // the tokens after on the line the lexing stopped on moved along it
+    ptrdiff_t cols = (ptrdiff_t)(state.offset - state.lineStart) - (ptrdiff_t)(old.offset - old.lineStart);
+    for (size_t i = stepIndex_; cols != 0 && i < entries_.size(); i++) {
+        moveStep(i + 1);
+        Entry &entry = entries_[i];
+        if (entry.line != state.line) break;
+        entry.col += (int)cols;
+        if (entry.after.line == state.line) entry.after.lineStart = state.lineStart;
+    }
+    return Change{first, next - first, lexed.size()};
+}
+
+Token IncrementalLexer::token(size_t i) const {
+    Entry entry = this->entry(i);
+    return Token(entry.type, text_.substr(entry.offset, entry.length), entry.line, entry.col);
+}
+
+size_t IncrementalLexer::find(size_t offset) const {
+    return firstEndingFrom(offset + 1);
+}
+
+IncrementalLexer::Entry IncrementalLexer::entry(size_t i) const {
+    Entry entry = entries_[i];
+    if (i >= stepIndex_) shift(entry, stepOffset_, stepLines_);
+    return entry;
+}
+
+// the first token whose end is at or after offset
+size_t IncrementalLexer::firstEndingFrom(size_t offset) const {
+    size_t low = 0, high = entries_.size();
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        Entry entry = this->entry(mid);
+        if (entry.offset + entry.length >= offset) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+void IncrementalLexer::shift(Entry &entry, ptrdiff_t offset, int lines) {
+    entry.offset += offset;
+    entry.line += lines;
+    entry.after.offset += offset;
+    entry.after.line += lines;
+    entry.after.lineStart += offset;
+}
+
+void IncrementalLexer::moveStep(size_t index) {
+    if (stepOffset_ == 0 && stepLines_ == 0) {
+        stepIndex_ = index;
+        return;
+    }
+    for (; stepIndex_ < index; stepIndex_++) {
+        shift(entries_[stepIndex_], stepOffset_, stepLines_);
+    }
+    for (; stepIndex_ > index; stepIndex_--) {
+        shift(entries_[stepIndex_ - 1], -stepOffset_, -stepLines_);
+    }
+}
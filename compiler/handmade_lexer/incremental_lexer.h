@@ -0,0 +1,64 @@
+#pragma once
+
+#include "gap_buffer.h"
+#include "lexer.h"
+#include "token.h"
+#include <cstddef>
+#include <string_view>
+
+// The tokens of a text being edited, as in an editor, kept up to date by
+// lexing again only around each edit. Lexing starts again from the state
+// after the last token that the edit could not have changed, and stops as
+// soon as the lexer is between tokens at a place it was before the edit,
+// past it; from there on the old tokens are kept, moved by the edit.
+//
+// The lexer's messages are not kept, the error tokens are.
+class IncrementalLexer {
+  public:
+    // the tokens an edit replaced: removed of them from first on, and
+    // inserted new ones in their place
+    struct Change {
+        size_t first = 0;
+        size_t removed = 0;
+        size_t inserted = 0;
+    };
+
+    // text is kept by the caller, as by Lexer, and lexed whole
+    explicit IncrementalLexer(std::string_view text);
+
+    // text is the whole text after the edit, which replaced removed bytes
+    // at offset with inserted new ones
+    Change edit(std::string_view text, size_t offset, size_t removed, size_t inserted);
+
+    // the eof token is not counted
+    size_t size() const { return entries_.size(); }
+    Token token(size_t i) const;
+    // the first token that ends after offset, or size() if none
+    size_t find(size_t offset) const;
+
+  private:
+    struct Entry {
+        TokenType type;
+        int line;
+        int col;
+        size_t offset;
+        size_t length;
+        Lexer::State after;
+    };
+
+    Entry entry(size_t i) const;
+    Lexer::State before(size_t i) const { return i == 0 ? Lexer::State() : entry(i - 1).after; }
+    size_t firstEndingFrom(size_t offset) const;
+    static void shift(Entry &entry, ptrdiff_t offset, int lines);
+    void moveStep(size_t index);
+
+    std::string_view text_;
+    GapBuffer<Entry> entries_;
+    // Entries from stepIndex_ on are stepOffset_ bytes and stepLines_ lines
+    // further on than they say. An edit adds to these instead of going
+    // through all the entries after it; the step is moved to the next edit
+    // through the entries between.
+    size_t stepIndex_ = 0;
+    ptrdiff_t stepOffset_ = 0;
+    int stepLines_ = 0;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "token.h"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Counts of each (type, lexeme) pair, for the stats. Open addressing over
+// one flat array; lexemes are views into the input, which outlives the
+// table, so counting a token copies nothing.
+class LexemeTable {
+  public:
+    struct Entry {
+        std::string_view lexeme;
+        TokenType type;
+        int count = 0;
+    };
+
+    LexemeTable() : slots_(1024) {}
+
+    void add(TokenType type, std::string_view lexeme, int count = 1) {
+        size_t mask = slots_.size() - 1;
+        for (size_t i = hash(type, lexeme) & mask;; i = (i + 1) & mask) {
+            Entry &entry = slots_[i];
+            if (entry.count == 0) {
+                entry = {lexeme, type, count};
+                if (++size_ * 2 > slots_.size()) grow();
+                return;
+            }
+            if (entry.type == type && entry.lexeme == lexeme) {
+                entry.count += count;
+                return;
+            }
+        }
+    }
+
+    // the entries in use, in no particular order
+    std::vector<Entry> entries() const {
+        std::vector<Entry> used;
+        used.reserve(size_);
+        for (const Entry &entry : slots_) {
+            if (entry.count) used.push_back(entry);
+        }
+        return used;
+    }
+
+  private:
+    static size_t hash(TokenType type, std::string_view lexeme) {
+        // FNV-1a
+        uint64_t h = 14695981039346656037ull ^ (uint64_t)type;
+        for (unsigned char c : lexeme) {
+            h = (h ^ c) * 1099511628211ull;
+        }
+        return (size_t)h;
+    }
+
+    void grow() {
+        std::vector<Entry> old(slots_.size() * 2);
+        old.swap(slots_);
+        size_t mask = slots_.size() - 1;
+        for (const Entry &entry : old) {
+            if (!entry.count) continue;
+            size_t i = hash(entry.type, entry.lexeme) & mask;
+            while (slots_[i].count) i = (i + 1) & mask;
+            slots_[i] = entry;
+        }
+    }
+
+    std::vector<Entry> slots_;
+    size_t size_ = 0;
+};
@@ -1,710 +1,638 @@
-#include "lexer.h"
-#include <cassert>
-#include <cctype>
-#include <iostream>
-#include <set>
-
-bool notascii(int c) {
-    return c > 127;
-}
-
-// consumed "\", peeked "u" or "U"
-bool Lexer::getUniversalCharacterName() {
-    std::string tmps;
-    int c = get();
-    assert(c == 'u' || c == 'U');
-    tmps += c;
-    int len = c == 'u' ? 4 : 8;
-    for (int i = 0; i < len; i++) {
-        c = peek();
-        if (!isxdigit(c)) {
-            error("invalid universal character name");
-            return false;
-        }
-        tmps += c;
-        get();
-    }
-    return true;
-}
-Token Lexer::getToken() {
-    enum {
-        start,
-        block_comment_1,
-        block_comment_2,
-        line_comment,
-        dot,
-        two_dot,
-        plus,
-        minus,
-        star,
-        slash,
-        percent,
-        caret,       // ^
-        ampersand,   // &
-        pipe,        // |
-        equal,       // =
-        exclamation, // !
-        less,        // <
-        greater,     // >
-        left_shift,  // <<
-        right_shift  // >>
-    } state = start;
-    token_.clear();
-    beginLine_ = line_;
-    beginRow_ = row_;
-    for (;;) {
-        int c = peek();
-        if (state == start && c == EOF) return Token("EOF", "", 0, 0);
-        switch (state) {
-        case start:
-            if (isspace(c)) {
-                pass();
-            } else if (isalpha(c) || c == '_' || c == '\\' || notascii(c)) {
-                return getIdentifierToken();
-            } else if (isdigit(c)) {
-                return getNumericToken(false);
-            } else {
-                switch (c) {
-                case '#':
-                    pass();
-                    state = line_comment;
-                    break;
-                case '\"':
-                    return getStringToken();
-                case '\'':
-                    return getCharToken();
-                case '.':
-                    get();
-                    state = dot;
-                    break;
-                case '+':
-                    get();
-                    state = plus;
-                    break;
-                case '-':
-                    get();
-                    state = minus;
-                    break;
-                case '*':
-                    get();
-                    state = star;
-                    break;
-                case '/':
-                    get();
-                    state = slash;
-                    break;
-                case '%':
-                    get();
-                    state = percent;
-                    break;
-                case '^':
-                    get();
-                    state = caret;
-                    break;
-                case '&':
-                    get();
-                    state = ampersand;
-                    break;
-                case '|':
-                    get();
-                    state = pipe;
-                    break;
-                case '=':
-                    get();
-                    state = equal;
-                    break;
-                case '!':
-                    get();
-                    state = exclamation;
-                    break;
-                case '<':
-                    get();
-                    state = less;
-                    break;
-                case '>':
-                    get();
-                    state = greater;
-                    break;
-                case '(':
-                case ')':
-                case '[':
-                case ']':
-                case '{':
-                case '}':
-                case ':':
-                case ';':
-                case '?':
-                case '~':
-                case ',':
-                    get();
-                    return makeToken("punctuator");
-                default:
-                    get();
-                    error(std::string("unknown character ") + (char)c);
-                    return makeToken("error");
-                }
-            }
-            break;
-        case line_comment:
-            if (c == '\n') {
-                state = start;
-            } else {
-                pass();
-            }
-            break;
-        case block_comment_1:
-            if (c == '*') {
-                pass();
-                state = block_comment_2;
-            } else if (c == EOF) {
-                error("unterminated block comment");
-                state = start;
-            } else {
-                pass();
-            }
-            break;
-        case block_comment_2:
-            if (c == '/') {
-                pass();
-                state = start;
-            } else if (c == EOF) {
-                error("unterminated block comment");
-                return makeToken("error");
-            } else {
-                pass();
-                state = block_comment_1;
-            }
-            break;
-        case dot:
-            if (isdigit(c)) {
-                return getNumericToken(true);
-            } else if (c == '.') {
-                get();
-                state = two_dot;
-            } else {
-                return makeToken("punctuator");
-            }
-            break;
-        case two_dot:
-            if (c == '.') {
-                get();
-                return makeToken("punctuator");
-            } else {
-                error("invalid token ..");
-                return makeToken("error");
-            }
-        case plus:
-            if (c == '+' || c == '=') get();
-            return makeToken("punctuator");
-        case minus:
-            if (c == '-' || c == '=' || c == '>') get();
-            return makeToken("punctuator");
-        case slash:
-            if (c == '/') {
-                get();
-                token_.clear();
-                state = line_comment;
-            } else if (c == '*') {
-                get();
-                token_.clear();
-                state = block_comment_1;
-            } else {
-                if (c == '=') get();
-                return makeToken("punctuator");
-            }
-            break;
-        case star:
-        case percent:
-        case caret:
-        case equal:
-        case left_shift:
-        case right_shift:
-        case exclamation:
-            if (c == '=') get();
-            return makeToken("punctuator");
-        case ampersand:
-            if (c == '&' || c == '=') get();
-            return makeToken("punctuator");
-        case pipe:
-            if (c == '|' || c == '=') get();
-            return makeToken("punctuator");
-        case greater:
-            if (c == '>') {
-                get();
-                state = right_shift;
-            } else {
-                if (c == '=') get();
-                return makeToken("punctuator");
-            }
-            break;
-        case less:
-            if (c == '<') {
-                get();
-                state = left_shift;
-            } else {
-                if (c == '=') get();
-                return makeToken("punctuator");
-            }
-            break;
-        }
-    }
-}
-
-void Lexer::printStat() {
-    printf("stat:\ntotal: %d characters, %d lines\n", charCount_, line_);
-    printf("tokens:\n");
-    int sum1 = 0;
-    for (auto &kv : stat_) {
-        printf("  %s:\n", kv.first.c_str());
-        int sum2 = 0;
-        for (auto &kv2 : kv.second) {
-            printf("    %-30s %d\n", kv2.first.c_str(), kv2.second);
-            sum2 += kv2.second;
-        }
-        printf("    %-30s %d\n", "(total)", sum2);
-        sum1 += sum2;
-    }
-    printf("  %-32s %d\n", "(total)", sum1);
-}
-
-// (possibly consumed .) peeked 0-9
-Token Lexer::getNumericToken(bool readDot) {
-    enum {
-        zero,
-        int_decimal,
-        int_octal,
-        int_octal_invalid,
-        int_hex_x,
-        int_hex,
-        float_decimal_fraction,
-        float_decimal_e,
-        float_decimal_sign,
-        float_decimal_exp,
-        float_hex_fraction,
-        float_hex_p,
-        float_hex_sign,
-        float_hex_exp,
-    } state;
-    if (readDot) {
-        state = float_decimal_fraction;
-    } else if (peek() == '0') {
-        state = zero;
-    } else {
-        state = int_decimal;
-    }
-    get();
-    for (;;) {
-        int c = peek();
-        switch (state) {
-        case zero:
-            if (c == 'x' || c == 'X') {
-                get();
-                state = int_hex_x;
-            } else if (c == '.') {
-                get();
-                state = float_decimal_fraction;
-            } else if (c >= '0' && c <= '7') {
-                get();
-                state = int_octal;
-            } else if (c == '8' || c == '9') {
-                get();
-                state = int_octal_invalid;
-            } else if (c == 'e' || c == 'E') {
-                get();
-                state = float_decimal_e;
-            } else {
-                if (getIntSuffix()) return makeToken("integer constant");
-                else return makeToken("error");
-            }
-            break;
-        case int_decimal:
-            if (isdigit(c)) {
-                get();
-                state = int_decimal;
-            } else if (c == '.') {
-                get();
-                state = float_decimal_fraction;
-            } else if (c == 'e' || c == 'E') {
-                get();
-                state = float_decimal_e;
-            } else {
-                if (getIntSuffix()) return makeToken("integer constant");
-                else return makeToken("error");
-            }
-            break;
-        case int_octal:
-            if (c >= '0' && c <= '7') {
-                get();
-                state = int_octal;
-            } else if (c == '8' || c == '9') {
-                get();
-                state = int_octal_invalid;
-            } else if (c == '.') {
-                get();
-                state = float_decimal_fraction;
-            } else if (c == 'e' || c == 'E') {
-                get();
-                state = float_decimal_e;
-            } else {
-                if (getIntSuffix()) return makeToken("integer constant");
-                else return makeToken("error");
-            }
-            break;
-        case int_octal_invalid:
-            if (isdigit(c)) {
-                get();
-                state = int_octal_invalid;
-            } else if (c == '.') {
-                get();
-                state = float_decimal_fraction;
-            } else if (c == 'e' || c == 'E') {
-                get();
-                state = float_decimal_e;
-            } else {
-                getIntSuffix();
-                error("invalid octal integer constant");
-                return makeToken("error");
-            }
-            break;
-        case int_hex_x:
-            if (isxdigit(c)) {
-                get();
-                state = int_hex;
-            } else {
-                error("invalid hex integer constant");
-                return makeToken("error");
-            }
-            break;
-        case int_hex:
-            if (isxdigit(c)) {
-                get();
-                state = int_hex;
-            } else if (c == '.') {
-                get();
-                state = float_hex_fraction;
-            } else if (c == 'p' || c == 'P') {
-                get();
-                state = float_hex_p;
-            } else {
-                if (getIntSuffix()) return makeToken("integer constant");
-                else return makeToken("error");
-            }
-            break;
-        case float_decimal_fraction:
-            if (isdigit(c)) {
-                get();
-                state = float_decimal_fraction;
-            } else if (c == 'e' || c == 'E') {
-                get();
-                state = float_decimal_e;
-            } else {
-                if (getFloatSuffix()) return makeToken("floating constant");
-                else return makeToken("error");
-            }
-            break;
-        case float_decimal_e:
-            if (isdigit(c)) {
-                get();
-                state = float_decimal_exp;
-            } else if (c == '+' || c == '-') {
-                get();
-                state = float_decimal_sign;
-            } else {
-                error("invalid float number");
-                return makeToken("error");
-            }
-            break;
-        case float_decimal_sign:
-            if (isdigit(c)) {
-                get();
-                state = float_decimal_exp;
-            } else {
-                error("invalid float number");
-                return makeToken("error");
-            }
-            break;
-        case float_decimal_exp:
-            if (isdigit(c)) {
-                get();
-                state = float_decimal_exp;
-            } else {
-                if (getFloatSuffix()) return makeToken("floating constant");
-                else return makeToken("error");
-            }
-            break;
-        case float_hex_fraction:
-            if (isxdigit(c)) {
-                get();
-                state = float_hex_fraction;
-            } else if (c == 'p' || c == 'P') {
-                get();
-                state = float_hex_p;
-            } else {
-                error("invalid hex float number");
-                return makeToken("error");
-            }
-            break;
-        case float_hex_p:
-            if (isdigit(c)) {
-                get();
-                state = float_hex_exp;
-            } else if (c == '+' || c == '-') {
-                get();
-                state = float_hex_sign;
-            } else {
-                error("invalid hex float number");
-                return makeToken("error");
-            }
-            break;
-        case float_hex_sign:
-            if (isdigit(c)) {
-                get();
-                state = float_hex_exp;
-            } else {
-                error("invalid hex float number");
-                return makeToken("error");
-            }
-            break;
-        case float_hex_exp:
-            if (isdigit(c)) {
-                get();
-                state = float_hex_exp;
-            } else {
-                if (getFloatSuffix()) return makeToken("floating constant");
-                else return makeToken("error");
-            }
-            break;
-        }
-    }
-}
-
-Token Lexer::makeToken(const std::string &type) {
-    stat_[type][token_]++;
-    return Token(type, token_, beginLine_, beginRow_);
-}
-
-Token Lexer::getIdentifierToken() {
-    int c = peek();
-    if (c == 'L' || c == 'u' || c == 'U') {
-        get();
-        int nx = peek();
-        if (nx == '\"') return getStringToken();
-        else if (nx == '\'') return getCharToken();
-        else if (c == 'u' && nx == '8') {
-            get();
-            c = peek();
-            if (c == '\"') return getStringToken();
-            else if (c == '\'') return getCharToken();
-        }
-    }
-    bool valid = true;
-    for (;;) {
-        int c = peek();
-        if (c == '\\') {
-            get();
-            c = peek();
-            if (c == 'u' || c == 'U') {
-                if (!getUniversalCharacterName()) valid = false;
-            } else {
-                error(std::string("expected u or U, got ") + (char)c);
-                valid = false;
-            }
-        } else if (isalnum(c) || c == '_' || notascii(c)) {
-            get();
-        } else {
-            static std::set<std::string> keywords = {
-                "auto",           "break",        "case",     "char",     "const",      "continue",
-                "default",        "do",           "double",   "else",     "enum",       "extern",
-                "float",          "for",          "goto",     "if",       "inline",     "int",
-                "long",           "register",     "restrict", "return",   "short",      "signed",
-                "sizeof",         "static",       "struct",   "switch",   "typedef",    "union",
-                "unsigned",       "void",         "volatile", "while",    "_Alignas",   "_Alignof",
-                "_Atomic",        "_Bool",        "_Complex", "_Generic", "_Imaginary", "_Noreturn",
-                "_Static_assert", "_Thread_local"};
-            if (valid) {
-                if (keywords.find(token_) != keywords.end()) return makeToken("keyword");
-                else return makeToken("identifier");
-            } else {
-                return makeToken("error");
-            }
-        }
-    }
-}
-
-// peeked "
-Token Lexer::getStringToken() {
-    bool valid = true;
-    get();
-    for (;;) {
-        int c = peek();
-        if (c == '\\') {
-            if (!getEscapeSequence()) valid = false;
-        } else if (c == '\"') {
-            get();
-            if (valid) return makeToken("string literal");
-            else return makeToken("error string literal");
-        } else if (c == '\n' || c == EOF) {
-            error("unterminated string literal");
-            return makeToken("error");
-        } else {
-            get();
-        }
-    }
-}
-
-// peeked '
-Token Lexer::getCharToken() {
-    get();
-    if (peek() == '\'') {
-        get();
-        error("empty char constant");
-        return makeToken("error");
-    }
-    for (;;) {
-        int c = peek();
-        if (c == '\\') {
-            if (!getEscapeSequence()) return makeToken("error");
-        } else if (c == '\'') {
-            get();
-            return makeToken("char constant");
-        } else if (c == '\n' || c == EOF) {
-            error("unterminated char constant");
-            return makeToken("error");
-        } else {
-            get();
-        }
-    }
-}
-
-bool Lexer::getIntSuffix() {
-    std::string suffix;
-    int c;
-    while (c = peek(), isalpha(c)) {
-        get();
-        suffix += c;
-    }
-    static std::set<std::string> valid_suffix = {
-        "",   "u",  "U",  "l",   "L",   "ll",  "LL",  "ul",  "uL",  "Ul",  "UL", "lu",
-        "lU", "Lu", "LU", "ull", "uLL", "Ull", "ULL", "llu", "llU", "LLu", "LLU"};
-
-    if (valid_suffix.find(suffix) == valid_suffix.end()) {
-        error("invalid integer suffix " + suffix);
-        return false;
-    }
-    return true;
-}
-
-bool Lexer::getFloatSuffix() {
-    std::string suffix;
-    int c;
-    while (c = peek(), isalpha(c)) {
-        get();
-        suffix += c;
-    }
-    if (suffix != "" && suffix != "f" && suffix != "F" && suffix != "l" && suffix != "L") {
-        error("invalid float number suffix " + suffix);
-        return false;
-    }
-    return true;
-}
-
-// peeked "\"
-bool Lexer::getEscapeSequence() {
-    int c = get();
-    assert(c == '\\');
-    c = peek();
-    // octal escape sequence
-    if (c >= '0' && c <= '7') {
-        get();
-        for (int i = 0; i < 2; i++) {
-            c = peek();
-            if (c >= '0' && c <= '7') {
-                get();
-            } else {
-                break;
-            }
-        }
-        return true;
-    }
-    // hex escape sequence
-    if (c == 'x') {
-        get();
-        while (isxdigit(peek())) {
-            get();
-        }
-        return true;
-    }
-    if (c == 'u' || c == 'U') {
-        return getUniversalCharacterName();
-    }
-    switch (c) {
-    case '\'':
-    case '\"':
-    case '?':
-    case '\\':
-    case 'a':
-    case 'b':
-    case 'f':
-    case 'n':
-    case 'r':
-    case 't':
-    case 'v':
-        get();
-        return true;
-    default:
-        get();
-        warning(std::string("unknown escape sequence \\") + (char)c);
-        return true;
-    }
-}
-
-int Lexer::peek() {
-    return in_.peek();
-}
-
-int Lexer::get() {
-    int c = in_.get();
-    if (c != EOF) {
-        charCount_++;
-        if (c == '\n') {
-            line_++;
-            row_ = 1;
-        } else {
-            row_++;
-        }
-        token_.push_back(c);
-    }
-    return c;
-}
-
-int Lexer::pass() {
-    int c = in_.get();
-    if (c != EOF) {
-        charCount_++;
-        if (c == '\n') {
-            line_++;
-            row_ = 1;
-        } else {
-            row_++;
-        }
-    }
-    beginLine_ = line_;
-    beginRow_ = row_;
-    return c;
-}
-
-void Lexer::error(const std::string &msg) {
-    std::cerr << line_ << ":" << row_ << ": ";
-    if (colored_) std::cerr << "\033[1;31m";
-    std::cerr << "error: ";
-    if (colored_) std::cerr << "\033[0m";
-    std::cerr << msg << std::endl;
-}
-
-void Lexer::warning(const std::string &msg) {
-    std::cerr << line_ << ":" << row_ << ": ";
-    if (colored_) std::cerr << "\033[1;33m";
-    std::cerr << "warning: ";
-    if (colored_) std::cerr << "\033[0m";
-    std::cerr << msg << std::endl;
-}
+#include "lexer.h"
+#include "scan.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+
+// The state machines below run on tables built at compile time: the
+// bytes are sorted into classes that the machine cannot tell apart, and
+// each state maps a class to the next state.
+namespace {
+
+enum CharFlag : unsigned char {
+    space = 1,
+    alpha = 2,
+    digit = 4,
+    xdigit = 8,
+    ident = 16,      // letters, digits, '_' and any non-ASCII byte
+    identStart = 32, // what an identifier (or a prefixed literal) starts with
+};
+
+constexpr std::array<unsigned char, 256> makeCharFlags() {
+    std::array<unsigned char, 256> flags{};
+    for (int c = 0; c < 256; c++) {
+        bool isAlpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        bool isDigit = c >= '0' && c <= '9';
+        if (c == ' ' || (c >= '\t' && c <= '\r')) flags[c] |= space;
+        if (isAlpha) flags[c] |= alpha;
+        if (isDigit) flags[c] |= digit;
+        if (isDigit || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')) flags[c] |= xdigit;
+        if (isAlpha || isDigit || c == '_' || c > 127) flags[c] |= ident;
+        if (isAlpha || c == '_' || c == '\\' || c > 127) flags[c] |= identStart;
+    }
+    return flags;
+}
+
+constexpr auto charFlags = makeCharFlags();
+
+bool has(int c, unsigned char flag) {
+    return c != EOF && (charFlags[c] & flag);
+}
+
+// Punctuators and comment openers as a trie, walked for the longest match.
+// ".." is only a node on the way to "...".
+enum PunctuatorKind : unsigned char { prefix, punctuator, lineComment, blockComment };
+
+struct PunctuatorSpelling {
+    const char *text;
+    PunctuatorKind kind;
+};
+
+constexpr PunctuatorSpelling punctuatorSpellings[] = {
+    {"{", punctuator},   {"}", punctuator},   {"[", punctuator},   {"]", punctuator},   {"(", punctuator},
+    {")", punctuator},   {";", punctuator},   {":", punctuator},   {"...", punctuator}, {"?", punctuator},
+    {".", punctuator},   {"->", punctuator},  {"~", punctuator},   {"!", punctuator},   {"+", punctuator},
+    {"-", punctuator},   {"*", punctuator},   {"/", punctuator},   {"%", punctuator},   {"^", punctuator},
+    {"&", punctuator},   {"|", punctuator},   {"=", punctuator},   {"+=", punctuator},  {"-=", punctuator},
+    {"*=", punctuator},  {"/=", punctuator},  {"%=", punctuator},  {"^=", punctuator},  {"&=", punctuator},
+    {"|=", punctuator},  {"==", punctuator},  {"!=", punctuator},  {"<", punctuator},   {">", punctuator},
+    {"<=", punctuator},  {">=", punctuator},  {"&&", punctuator},  {"||", punctuator},  {"<<", punctuator},
+    {">>", punctuator},  {"<<=", punctuator}, {">>=", punctuator}, {"++", punctuator},  {"--", punctuator},
+    {",", punctuator},   {"//", lineComment}, {"/*", blockComment},
+};
+
+struct PunctuatorTable {
+    static constexpr int maxNodes = 64, maxClasses = 32;
+    // class 0 is every byte that is in no spelling, and has no transitions
+    std::array<unsigned char, 256> classOf{};
+    // 0 for no transition, the root is never a target
+    std::array<std::array<unsigned char, maxClasses>, maxNodes> next{};
+    std::array<PunctuatorKind, maxNodes> kind{};
+    int nodes = 1;
+    int classes = 1;
+};
+
+constexpr PunctuatorTable makePunctuatorTable() {
+    PunctuatorTable table;
+    for (const auto &spelling : punctuatorSpellings) {
+        int node = 0;
+        for (const char *p = spelling.text; *p; p++) {
+            auto c = (unsigned char)*p;
+            if (!table.classOf[c]) {
+                if (table.classes == PunctuatorTable::maxClasses) throw "too many punctuator characters";
+                table.classOf[c] = table.classes++;
+            }
+            auto &next = table.next[node][table.classOf[c]];
+            if (!next) {
+                if (table.nodes == PunctuatorTable::maxNodes) throw "too many punctuator prefixes";
+                next = table.nodes++;
+            }
+            node = next;
+        }
+        table.kind[node] = spelling.kind;
+    }
+    return table;
+}
+
+constexpr auto punctuatorTable = makePunctuatorTable();
+
+int punctuatorClass(int c) {
+    return c == EOF ? 0 : punctuatorTable.classOf[c];
+}
+
+// Keywords by a perfect hash of the first two and the last characters and
+// the length; building the table fails to compile if two keywords collide.
+constexpr std::string_view keywords[] = {
+    "auto",     "break",      "case",      "char",           "const",        "continue", "default",
+    "do",       "double",     "else",      "enum",           "extern",       "float",    "for",
+    "goto",     "if",         "inline",    "int",            "long",         "register", "restrict",
+    "return",   "short",      "signed",    "sizeof",         "static",       "struct",   "switch",
+    "typedef",  "union",      "unsigned",  "void",           "volatile",     "while",    "_Alignas",
+    "_Alignof", "_Atomic",    "_Bool",     "_Complex",       "_Generic",     "_Imaginary", "_Noreturn",
+    "_Static_assert", "_Thread_local"};
+
+constexpr size_t keywordSlots = 128;
+
+constexpr size_t keywordHash(std::string_view word) {
+    return ((unsigned char)word[0] * 3 + (unsigned char)word[1] * 32 + (unsigned char)word.back()
+            + word.size() * 10) % keywordSlots;
+}
+
+constexpr std::array<std::string_view, keywordSlots> makeKeywordTable() {
+    std::array<std::string_view, keywordSlots> table{};
+    for (auto keyword : keywords) {
+        auto &slot = table[keywordHash(keyword)];
+        if (!slot.empty()) throw "keyword hash collision";
+        slot = keyword;
+    }
+    return table;
+}
+
+constexpr auto keywordTable = makeKeywordTable();
+
+bool isKeyword(std::string_view word) {
+    // every keyword has 2 to 14 characters
+    return word.size() >= 2 && word.size() <= 14 && keywordTable[keywordHash(word)] == word;
+}
+
+// The states of getNumericToken, see doc/fig2.
+enum NumericState : unsigned char {
+    zero,
+    int_decimal,
+    int_octal,
+    int_octal_invalid,
+    int_hex_x,
+    int_hex,
+    float_decimal_fraction,
+    float_decimal_e,
+    float_decimal_sign,
+    float_decimal_exp,
+    float_hex_fraction,
+    float_hex_p,
+    float_hex_sign,
+    float_hex_exp,
+    numericStateCount,
+    numeric_end = numericStateCount,
+};
+
+enum NumericClass : unsigned char {
+    n_other,
+    n_zero,    // 0
+    n_octal,   // 1-7
+    n_decimal, // 8 9
+    n_hex,     // a-d f A-D F
+    n_e,       // e E, also a hex digit
+    n_x,
+    n_p,
+    n_dot,
+    n_sign,
+    numericClassCount,
+};
+
+// what a number that stops in each state is
+enum NumericEnd : unsigned char { int_suffix, float_suffix, invalid_octal, invalid_hex_int, invalid_float, invalid_hex_float };
+
+struct NumericTable {
+    std::array<unsigned char, 256> classOf{};
+    std::array<std::array<NumericState, numericClassCount>, numericStateCount> next{};
+    std::array<NumericEnd, numericStateCount> end{};
+};
+
+constexpr NumericTable makeNumericTable() {
+    NumericTable table;
+    for (int c = 0; c < 256; c++) {
+        table.classOf[c] = c == '0'                                                  ? n_zero
+                         : c >= '1' && c <= '7'                                      ? n_octal
+                         : c == '8' || c == '9'                                      ? n_decimal
+                         : c == 'e' || c == 'E'                                      ? n_e
+                         : (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')          ? n_hex
+                         : c == 'x' || c == 'X'                                      ? n_x
+                         : c == 'p' || c == 'P'                                      ? n_p
+                         : c == '.'                                                  ? n_dot
+                         : c == '+' || c == '-'                                      ? n_sign
+                                                                                     : n_other;
+    }
+    for (auto &row : table.next) {
+        for (auto &next : row) next = numeric_end;
+    }
+    auto on = [&table](NumericState from, std::initializer_list<NumericClass> classes, NumericState to) {
+        for (auto c : classes) table.next[from][c] = to;
+    };
+    const auto digits = {n_zero, n_octal, n_decimal};
+    const auto hexDigits = {n_zero, n_octal, n_decimal, n_hex, n_e};
+
+    on(zero, {n_x}, int_hex_x);
+    on(zero, {n_dot}, float_decimal_fraction);
+    on(zero, {n_zero, n_octal}, int_octal);
+    on(zero, {n_decimal}, int_octal_invalid);
+    on(zero, {n_e}, float_decimal_e);
+    on(int_decimal, digits, int_decimal);
+    on(int_decimal, {n_dot}, float_decimal_fraction);
+    on(int_decimal, {n_e}, float_decimal_e);
+    on(int_octal, {n_zero, n_octal}, int_octal);
+    on(int_octal, {n_decimal}, int_octal_invalid);
+    on(int_octal, {n_dot}, float_decimal_fraction);
+    on(int_octal, {n_e}, float_decimal_e);
+    on(int_octal_invalid, digits, int_octal_invalid);
+    on(int_octal_invalid, {n_dot}, float_decimal_fraction);
+    on(int_octal_invalid, {n_e}, float_decimal_e);
+    on(int_hex_x, hexDigits, int_hex);
+    on(int_hex, hexDigits, int_hex);
+    on(int_hex, {n_dot}, float_hex_fraction);
+    on(int_hex, {n_p}, float_hex_p);
+    on(float_decimal_fraction, digits, float_decimal_fraction);
+    on(float_decimal_fraction, {n_e}, float_decimal_e);
+    on(float_decimal_e, digits, float_decimal_exp);
+    on(float_decimal_e, {n_sign}, float_decimal_sign);
+    on(float_decimal_sign, digits, float_decimal_exp);
+    on(float_decimal_exp, digits, float_decimal_exp);
+    on(float_hex_fraction, hexDigits, float_hex_fraction);
+    on(float_hex_fraction, {n_p}, float_hex_p);
+    on(float_hex_p, digits, float_hex_exp);
+    on(float_hex_p, {n_sign}, float_hex_sign);
+    on(float_hex_sign, digits, float_hex_exp);
+    on(float_hex_exp, digits, float_hex_exp);
+
+    table.end = {int_suffix,     int_suffix,      int_suffix,    invalid_octal,     invalid_hex_int,
+                 int_suffix,     float_suffix,    invalid_float, invalid_float,     float_suffix,
+                 invalid_hex_float, invalid_hex_float, invalid_hex_float, float_suffix};
+    return table;
+}
+
+constexpr auto numericTable = makeNumericTable();
+
+} // namespace
+
+// consumed "\", peeked "u" or "U"
+bool Lexer::getUniversalCharacterName() {
+    int c = get();
+    assert(c == 'u' || c == 'U');
+    int len = c == 'u' ? 4 : 8;
+    for (int i = 0; i < len; i++) {
+        if (!has(peek(), xdigit)) {
+            error("invalid universal character name");
+            return false;
+        }
+        get();
+    }
+    return true;
+}
+
+Token Lexer::getToken() {
+    for (;;) {
+        cur_ = skipSpaces(cur_, end_);
+        beginToken();
+        int c = peek();
+        if (c == EOF) return Token(TokenType::eof, "", 0, 0);
+        if (has(c, identStart)) {
+            return getIdentifierToken();
+        } else if (has(c, digit)) {
+            return getNumericToken(false);
+        } else if (c == '#') {
+            skipLineComment();
+        } else if (c == '\"') {
+            return getStringToken();
+        } else if (c == '\'') {
+            return getCharToken();
+        } else if (punctuatorClass(c)) {
+            int node = 0;
+            while (int next = punctuatorTable.next[node][punctuatorClass(peek())]) {
+                get();
+                node = next;
+            }
+            switch (punctuatorTable.kind[node]) {
+            case punctuator:
+                if (cur_ - tokenBegin_ == 1 && *tokenBegin_ == '.' && has(peek(), digit)) {
+                    return getNumericToken(true);
+                }
+                return makeToken(TokenType::punctuator);
+            case lineComment:
+                skipLineComment();
+                break;
+            case blockComment:
+                if (!skipBlockComment()) {
+                    beginToken();
+                    return makeToken(TokenType::error);
+                }
+                break;
+            case prefix:
+                error("invalid token ..");
+                return makeToken(TokenType::error);
+            }
+        } else {
+            get();
+            error(std::string("unknown character ") + (char)c);
+            return makeToken(TokenType::error);
+        }
+    }
+}
+
+size_t Lexer::getTokens(Token *out, size_t capacity) {
+    size_t count = 0;
+    while (count < capacity) {
+        Token token = getToken();
+        if (token.type == TokenType::eof) break;
+        out[count++] = token;
+    }
+    return count;
+}
+
+Lexer::State Lexer::state() {
+    int line, col;
+    locate(cur_, line, col);
+    return State{(size_t)(cur_ - begin_), line, (size_t)(lineStart_ - begin_)};
+}
+
+void Lexer::restore(const State &state) {
+    cur_ = tokenBegin_ = lineCursor_ = begin_ + state.offset;
+    lineStart_ = begin_ + state.lineStart;
+    newlines_ = state.line - 1;
+    ranIntoEnd_ = false;
+}
+
+// up to the end of the line, which is left for the caller
+void Lexer::skipLineComment() {
+    cur_ = findByte(cur_, end_, '\n');
+}
+
+// consumed "/*". A "*" right after a "*" is not taken as the start of the
+// "*/", so "**/" does not end a comment: a run of stars ends it only when
+// the run is odd. False when the input ends right after such a run, which
+// is reported as an error token.
+bool Lexer::skipBlockComment() {
+    for (;;) {
+        const char *stars = findByte(cur_, end_, '*');
+        cur_ = stars;
+        while (cur_ < end_ && *cur_ == '*') cur_++;
+        bool odd = (cur_ - stars) % 2 == 1;
+        if (cur_ == end_) {
+            ranIntoEnd_ = true;
+            error("unterminated block comment");
+            return !odd;
+        }
+        if (odd && *cur_ == '/') {
+            cur_++;
+            return true;
+        }
+    }
+}
+
+void Lexer::printStat() {
+    int line, col;
+    locate(cur_, line, col);
+    ::printStat(stat_, (int)(cur_ - begin_), line);
+}
+
+void printStat(const LexemeTable &stat, int characters, int lines) {
+    printf("stat:\ntotal: %d characters, %d lines\n", characters, lines);
+    printf("tokens:\n");
+    // grouped by the name of the type, each group in lexeme order
+    auto entries = stat.entries();
+    std::sort(entries.begin(), entries.end(), [](const LexemeTable::Entry &a, const LexemeTable::Entry &b) {
+        int order = strcmp(tokenTypeName(a.type), tokenTypeName(b.type));
+        return order != 0 ? order < 0 : a.lexeme < b.lexeme;
+    });
+    int sum1 = 0;
+    for (size_t i = 0; i < entries.size();) {
+        TokenType type = entries[i].type;
+        printf("  %s:\n", tokenTypeName(type));
+        int sum2 = 0;
+        for (; i < entries.size() && entries[i].type == type; i++) {
+            printf("    %-30.*s %d\n", (int)entries[i].lexeme.size(), entries[i].lexeme.data(), entries[i].count);
+            sum2 += entries[i].count;
+        }
+        printf("    %-30s %d\n", "(total)", sum2);
+        sum1 += sum2;
+    }
+    printf("  %-32s %d\n", "(total)", sum1);
+}
+
+// (possibly consumed .) peeked 0-9
+Token Lexer::getNumericToken(bool readDot) {
+    int state = readDot ? float_decimal_fraction : peek() == '0' ? zero : int_decimal;
+    get();
+    for (;;) {
+        int c = peek();
+        int next = numericTable.next[state][c == EOF ? (int)n_other : numericTable.classOf[c]];
+        if (next == numeric_end) break;
+        get();
+        state = next;
+    }
+    switch (numericTable.end[state]) {
+    case int_suffix:
+        return makeToken(getIntSuffix() ? TokenType::integer_constant : TokenType::error);
+    case float_suffix:
+        return makeToken(getFloatSuffix() ? TokenType::floating_constant : TokenType::error);
+    case invalid_octal:
+        getIntSuffix();
+        error("invalid octal integer constant");
+        break;
+    case invalid_hex_int:
+        error("invalid hex integer constant");
+        break;
+    case invalid_float:
+        error("invalid float number");
+        break;
+    case invalid_hex_float:
+        error("invalid hex float number");
+        break;
+    }
+    return makeToken(TokenType::error);
+}
+
+Token Lexer::makeToken(TokenType type) {
+    std::string_view val(tokenBegin_, cur_ - tokenBegin_);
+    if (cur_ == end_) ranIntoEnd_ = true;
+    if (stats_) stat_.add(type, val);
+    return Token(type, val, beginLine_, beginRow_);
+}
+
+Token Lexer::getIdentifierToken() {
+    int c = peek();
+    if (c == 'L' || c == 'u' || c == 'U') {
+        get();
+        int nx = peek();
+        if (nx == '\"') return getStringToken();
+        else if (nx == '\'') return getCharToken();
+        else if (c == 'u' && nx == '8') {
+            get();
+            c = peek();
+            if (c == '\"') return getStringToken();
+            else if (c == '\'') return getCharToken();
+        }
+    }
+    bool valid = true;
+    for (;;) {
+        int c = peek();
+        if (c == '\\') {
+            get();
+            c = peek();
+            if (c == 'u' || c == 'U') {
+                if (!getUniversalCharacterName()) valid = false;
+            } else {
+                error(std::string("expected u or U, got ") + (char)c);
+                valid = false;
+            }
+        } else if (has(c, ident)) {
+            cur_ = skipIdentifierChars(cur_, end_);
+        } else {
+            if (valid) {
+                if (isKeyword(std::string_view(tokenBegin_, cur_ - tokenBegin_))) return makeToken(TokenType::keyword);
+                else return makeToken(TokenType::identifier);
+            } else {
+                return makeToken(TokenType::error);
+            }
+        }
+    }
+}
+
+// peeked "
+Token Lexer::getStringToken() {
+    bool valid = true;
+    get();
+    for (;;) {
+        int c = peek();
+        if (c == '\\') {
+            if (!getEscapeSequence()) valid = false;
+        } else if (c == '\"') {
+            get();
+            if (valid) return makeToken(TokenType::string_literal);
+            else return makeToken(TokenType::error_string_literal);
+        } else if (c == '\n' || c == EOF) {
+            error("unterminated string literal");
+            return makeToken(TokenType::error);
+        } else {
+            get();
+        }
+    }
+}
+
+// peeked '
+Token Lexer::getCharToken() {
+    get();
+    if (peek() == '\'') {
+        get();
+        error("empty char constant");
+        return makeToken(TokenType::error);
+    }
+    for (;;) {
+        int c = peek();
+        if (c == '\\') {
+            if (!getEscapeSequence()) return makeToken(TokenType::error);
+        } else if (c == '\'') {
+            get();
+            return makeToken(TokenType::char_constant);
+        } else if (c == '\n' || c == EOF) {
+            error("unterminated char constant");
+            return makeToken(TokenType::error);
+        } else {
+            get();
+        }
+    }
+}
+
+// the letters after a number
+std::string_view Lexer::getSuffix() {
+    const char *begin = cur_;
+    while (has(peek(), alpha)) {
+        get();
+    }
+    return std::string_view(begin, cur_ - begin);
+}
+
+bool Lexer::getIntSuffix() {
+    static constexpr std::string_view validSuffixes[] = {
+        "",   "u",  "U",  "l",   "L",   "ll",  "LL",  "ul",  "uL",  "Ul",  "UL", "lu",
+        "lU", "Lu", "LU", "ull", "uLL", "Ull", "ULL", "llu", "llU", "LLu", "LLU"};
+    std::string_view suffix = getSuffix();
+    if (std::find(std::begin(validSuffixes), std::end(validSuffixes), suffix) == std::end(validSuffixes)) {
+        error("invalid integer suffix " + std::string(suffix));
+        return false;
+    }
+    return true;
+}
+
+bool Lexer::getFloatSuffix() {
+    std::string_view suffix = getSuffix();
+    if (suffix != "" && suffix != "f" && suffix != "F" && suffix != "l" && suffix != "L") {
+        error("invalid float number suffix " + std::string(suffix));
+        return false;
+    }
+    return true;
+}
+
+// peeked "\"
+bool Lexer::getEscapeSequence() {
+    int c = get();
+    assert(c == '\\');
+    c = peek();
+    // octal escape sequence
+    if (c >= '0' && c <= '7') {
+        get();
+        for (int i = 0; i < 2; i++) {
+            c = peek();
+            if (c >= '0' && c <= '7') {
+                get();
+            } else {
+                break;
+            }
+        }
+        return true;
+    }
+    // hex escape sequence
+    if (c == 'x') {
+        get();
+        while (has(peek(), xdigit)) {
+            get();
+        }
+        return true;
+    }
+    if (c == 'u' || c == 'U') {
+        return getUniversalCharacterName();
+    }
+    switch (c) {
+    case '\'':
+    case '\"':
+    case '?':
+    case '\\':
+    case 'a':
+    case 'b':
+    case 'f':
+    case 'n':
+    case 'r':
+    case 't':
+    case 'v':
+        get();
+        return true;
+    default:
+        get();
+        warning(std::string("unknown escape sequence \\") + (char)c);
+        return true;
+    }
+}
+
+int Lexer::peek() {
+    return cur_ < end_ ? (unsigned char)*cur_ : EOF;
+}
+
+int Lexer::get() {
+    return cur_ < end_ ? (unsigned char)*cur_++ : EOF;
+}
+
+void Lexer::beginToken() {
+    tokenBegin_ = cur_;
+    locate(cur_, beginLine_, beginRow_);
+}
+
+void Lexer::locate(const char *p, int &line, int &col) {
+    const char *lastNewline = nullptr;
+    newlines_ += (int)countNewlines(lineCursor_, p, &lastNewline);
+    if (lastNewline) lineStart_ = lastNewline + 1;
+    lineCursor_ = p;
+    line = newlines_ + 1;
+    col = (int)(p - lineStart_) + 1;
+}
+
+void Lexer::error(const std::string &msg) {
+    int line, col;
+    locate(cur_, line, col);
+    messages_ << line << ":" << col << ": ";
+    if (colored_) messages_ << "\033[1;31m";
+    messages_ << "error: ";
+    if (colored_) messages_ << "\033[0m";
+    messages_ << msg << std::endl;
+}
+
+void Lexer::warning(const std::string &msg) {
+    int line, col;
+    locate(cur_, line, col);
+    messages_ << line << ":" << col << ": ";
+    if (colored_) messages_ << "\033[1;33m";
+    messages_ << "warning: ";
+    if (colored_) messages_ << "\033[0m";
+    messages_ << msg << std::endl;
+}
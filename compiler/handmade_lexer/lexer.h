@@ -1,43 +1,91 @@
-#pragma once
-
-#include "token.h"
-#include <map>
-
-class Lexer {
-  public:
-    Lexer(std::istream &in, bool colored = true) : in_(in), colored_(colored) {}
-
-    Token getToken();
-    void printStat();
-
-  private:
-    std::istream &in_;
-    std::string token_;
-    int line_ = 1;
-    int row_ = 1;
-    int beginLine_;
-    int beginRow_;
-    bool colored_;
-    std::map<std::string, std::map<std::string, int>> stat_;
-    int charCount_ = 0;
-    int lineCount_ = 0;
-
-    int peek();
-    int get();
-    int pass();
-
-    Token makeToken(const std::string &type);
-
-    Token getIdentifierToken();
-    Token getStringToken();
-    Token getCharToken();
-    Token getNumericToken(bool readDot);
-
-    bool getEscapeSequence();
-    bool getIntSuffix();
-    bool getFloatSuffix();
-    bool getUniversalCharacterName();
-  
-    void error(const std::string &msg);
-    void warning(const std::string &msg);
-};
+#pragma once
+
+#include "lexeme_table.h"
+#include "token.h"
+#include <iostream>
+#include <string>
+#include <string_view>
+
+// the stats printed at the end, from the counts of a whole input
+void printStat(const LexemeTable &stat, int characters, int lines);
+
+class Lexer {
+  public:
+    // Where the lexer is between two tokens. Nothing else carries over
+    // from one token to the next, so a Lexer given the same input can go
+    // on from here, or from the same place in an input changed only
+    // before it.
+    struct State {
+        size_t offset = 0;
+        int line = 1;
+        // offset of the start of line
+        size_t lineStart = 0;
+    };
+
+    // input is read in place and has to outlive the lexer and its tokens;
+    // without stats, printStat() has only the character and line counts.
+    // An input that is a part of a larger one starts at the beginning of
+    // line firstLine of it.
+    Lexer(std::string_view input, bool colored = true, bool stats = true, int firstLine = 1,
+          std::ostream &messages = std::cerr)
+        : begin_(input.data()), cur_(begin_), end_(begin_ + input.size()), tokenBegin_(cur_),
+          lineCursor_(begin_), lineStart_(begin_), newlines_(firstLine - 1), colored_(colored), stats_(stats),
+          messages_(messages) {}
+
+    Token getToken();
+    // Fills out with the next tokens, up to capacity of them, and returns
+    // how many. Fewer than capacity only at the end of the input, which is
+    // not itself stored as a token.
+    size_t getTokens(Token *out, size_t capacity);
+    // before the next token
+    State state();
+    void restore(const State &state);
+    void printStat();
+    const LexemeTable &stat() const { return stat_; }
+    // whether a token or comment was cut short by the end of the input,
+    // rather than ending before it
+    bool ranIntoEnd() const { return ranIntoEnd_; }
+
+  private:
+    const char *begin_;
+    const char *cur_;
+    const char *end_;
+    // the current token is [tokenBegin_, cur_)
+    const char *tokenBegin_;
+    int beginLine_;
+    int beginRow_;
+    // Lines are counted only when a position is needed, up to lineCursor_;
+    // lineStart_ is the start of the line lineCursor_ is on.
+    const char *lineCursor_;
+    const char *lineStart_;
+    int newlines_;
+    bool colored_;
+    bool stats_;
+    LexemeTable stat_;
+    std::ostream &messages_;
+    bool ranIntoEnd_ = false;
+
+    int peek();
+    int get();
+    void beginToken();
+    // p is never before the last p asked about
+    void locate(const char *p, int &line, int &col);
+
+    Token makeToken(TokenType type);
+
+    Token getIdentifierToken();
+    Token getStringToken();
+    Token getCharToken();
+    Token getNumericToken(bool readDot);
+    void skipLineComment();
+    bool skipBlockComment();
+
+    bool getEscapeSequence();
+    std::string_view getSuffix();
+    bool getIntSuffix();
+    bool getFloatSuffix();
+    bool getUniversalCharacterName();
+  
+    void error(const std::string &msg);
+    void warning(const std::string &msg);
+};
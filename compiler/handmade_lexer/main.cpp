@@ -1,55 +1,103 @@
-#include "lexer.h"
-#include <cstring>
-#include <fstream>
-#include <io.h>
-#include <iostream>
-#ifdef _WIN32
-#include <windows.h>
-#endif
-
-void error(const std::string &msg, bool colored);
-void initColor();
-
-int main(int argc, char *argv[]) {
-    bool colored = isatty(fileno(stderr));
-    if (colored) initColor();
-
-    std::ifstream fin;
-    if (argc > 1) {
-        fin.open(argv[1]);
-        if (!fin) {
-            error(strerror(errno), colored);
-            return 1;
-        }
-    }
-    std::istream &in = argc > 1 ? fin : std::cin;
-    Lexer lexer(in, colored);
-    for (;;) {
-        Token token = lexer.getToken();
-        if (token.type == "EOF") {
-            break;
-        } else {
-            token.print();
-        }
-    }
-    std::cout << std::endl;
-    lexer.printStat();
-    return 0;
-}
-
-void error(const std::string &msg, bool colored) {
-    if (colored) std::cerr << "\033[1;31m";
-    std::cerr << "error: ";
-    if (colored) std::cerr << "\033[0m";
-    std::cerr << msg << std::endl;
-}
-
-void initColor() {
-#ifdef _WIN32
-    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-    DWORD dwMode = 0;
-    GetConsoleMode(hOut, &dwMode);
-    dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
-    SetConsoleMode(hOut, dwMode);
-#endif
+#include "lexer.h"
+#include "mapped_file.h"
+#include "parallel_lexer.h"
+#include "token_writer.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <io.h>
+#include <iostream>
+#include <iterator>
+#include <thread>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <windows.h>
+#endif
+
+void error(const std::string &msg, bool colored);
+void initColor();
+
+// lexer [--no-stat] [--binary] [-j threads] [file]
+// --binary writes the tokens in the binary form of TokenWriter, without the
+// stats, for another program to read
+int main(int argc, char *argv[]) {
+    bool colored = isatty(fileno(stderr));
+    if (colored) initColor();
+
+    bool stats = true;
+    bool binary = false;
+    unsigned threads = 1;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-stat") == 0) {
+            stats = false;
+        } else if (strcmp(argv[i], "--binary") == 0) {
+            binary = true;
+            stats = false;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            // 0 for one thread per core
+            threads = (unsigned)atoi(argv[++i]);
+            if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+        } else {
+            path = argv[i];
+        }
+    }
+
+    // a file is mapped, standard input read whole; the lexer works in place
+    MappedFile file;
+    std::string stdinText;
+    std::string_view input;
+    if (path) {
+        if (!file.open(path)) {
+            error(strerror(errno), colored);
+            return 1;
+        }
+        input = file.data();
+    } else {
+        stdinText.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+        input = stdinText;
+    }
+#ifdef _WIN32
+    if (binary) _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    TokenWriter writer(stdout, binary ? TokenWriter::Format::binary : TokenWriter::Format::text);
+    if (threads > 1) {
+        ParallelLexer lexer(input, colored, stats, threads);
+        lexer.run();
+        lexer.writeTokens(writer);
+        writer.finish();
+        if (binary) return 0;
+        std::cout << std::endl;
+        lexer.printStat();
+        return 0;
+    }
+    Lexer lexer(input, colored, stats);
+    Token tokens[1024];
+    for (;;) {
+        size_t count = lexer.getTokens(tokens, std::size(tokens));
+        writer.write(tokens, count);
+        if (count < std::size(tokens)) break;
+    }
+    writer.finish();
+    if (binary) return 0;
+    std::cout << std::endl;
+    lexer.printStat();
+    return 0;
+}
+
+void error(const std::string &msg, bool colored) {
+    if (colored) std::cerr << "\033[1;31m";
+    std::cerr << "error: ";
+    if (colored) std::cerr << "\033[0m";
+    std::cerr << msg << std::endl;
+}
+
+void initColor() {
+#ifdef _WIN32
+    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD dwMode = 0;
+    GetConsoleMode(hOut, &dwMode);
+    dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+    SetConsoleMode(hOut, dwMode);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include "parallel_lexer.h"
+#include "lexer.h"
+#include "scan.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// below this a chunk is not worth a thread
+const size_t minChunkSize = 256 * 1024;
+// how far past where a cut is wanted to look for a likely one
+const size_t cutSearchLength = 64 * 1024;
+
+// A line starting at its first column with one of these is most likely
+// outside of any comment: declarations, preprocessor lines and the end of
+// a function body. Lines inside comments tend to start with spaces or "*".
+bool startsTopLevel(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '#' || c == '}';
+}
+
+// the beginning of a line at or after p, preferring one that looks to be
+// outside of comments; end if there is no line after p
+const char *findCut(const char *p, const char *end) {
+    const char *first = nullptr;
+    const char *limit = end - p > (ptrdiff_t)cutSearchLength ? p + cutSearchLength : end;
+    for (;;) {
+        p = findByte(p, end, '\n');
+        if (p == end) return first ? first : end;
+        p++;
+        if (!first) first = p;
+        if (p == end || startsTopLevel(*p)) return p;
+        if (p >= limit) return first;
+    }
+}
+
+} // namespace
+
+ParallelLexer::ParallelLexer(std::string_view input, bool colored, bool stats, unsigned threads)
+    : input_(input), colored_(colored), stats_(stats), threads_(std::max(threads, 1u)) {}
+
+void ParallelLexer::split() {
+    const char *begin = input_.data();
+    const char *end = begin + input_.size();
+    // a few chunks a thread, so one slow chunk does not hold up the rest
+    size_t count = std::min<size_t>(threads_ * 4, input_.size() / minChunkSize);
+    if (threads_ == 1 || count < 2) count = 1;
+    const char *chunkBegin = begin;
+    int line = 1;
+    for (size_t i = 1; i <= count && chunkBegin < end; i++) {
+        const char *chunkEnd = i == count ? end : findCut(begin + input_.size() / count * i, end);
+        if (chunkEnd <= chunkBegin) continue;
+        Chunk chunk;
+        chunk.text = std::string_view(chunkBegin, chunkEnd - chunkBegin);
+        chunk.firstLine = line;
+        chunks_.push_back(std::move(chunk));
+        const char *last;
+        line += (int)countNewlines(chunkBegin, chunkEnd, &last);
+        chunkBegin = chunkEnd;
+    }
+    if (chunks_.empty()) {
+        chunks_.push_back(Chunk{input_, 1, {}, {}, {}, false});
+    }
+}
+
+void ParallelLexer::lex(Chunk &chunk) {
+    std::ostringstream messages;
+    Lexer lexer(chunk.text, colored_, stats_, chunk.firstLine, messages);
+    const size_t batch = 4096;
+    chunk.tokens.clear();
+    for (;;) {
+        size_t size = chunk.tokens.size();
+        chunk.tokens.resize(size + batch);
+        size_t count = lexer.getTokens(chunk.tokens.data() + size, batch);
+        chunk.tokens.resize(size + count);
+        if (count < batch) break;
+    }
+    chunk.messages = messages.str();
+    chunk.stat = lexer.stat();
+    chunk.ranIntoEnd = lexer.ranIntoEnd();
+}
+
+void ParallelLexer::run() {
+    split();
+    std::atomic<size_t> next{0};
+    auto work = [this, &next] {
+        for (size_t i; (i = next++) < chunks_.size();) {
+            lex(chunks_[i]);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min<size_t>(threads_, chunks_.size()); i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    // A chunk whose end cut a token or comment short was not cut where a
+    // single lexer would have been between tokens, and neither was the one
+    // after it started there. Both are lexed again as one, until the end of
+    // the merged chunk is a real one.
+    for (size_t i = 0; i < chunks_.size(); i++) {
+        while (chunks_[i].ranIntoEnd && i + 1 < chunks_.size()) {
+            std::string_view after = chunks_[i + 1].text;
+            chunks_[i].text = std::string_view(chunks_[i].text.data(), chunks_[i].text.size() + after.size());
+            chunks_.erase(chunks_.begin() + i + 1);
+            lex(chunks_[i]);
+        }
+        std::cerr << chunks_[i].messages;
+    }
+}
+
+void ParallelLexer::writeTokens(TokenWriter &writer) {
+    for (const auto &chunk : chunks_) {
+        writer.write(chunk.tokens.data(), chunk.tokens.size());
+    }
+}
+
+void ParallelLexer::printStat() {
+    LexemeTable stat;
+    for (const auto &chunk : chunks_) {
+        for (const auto &entry : chunk.stat.entries()) {
+            stat.add(entry.type, entry.lexeme, entry.count);
+        }
+    }
+    const char *last;
+    int newlines = (int)countNewlines(input_.data(), input_.data() + input_.size(), &last);
+    ::printStat(stat, (int)input_.size(), newlines + 1);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "lexeme_table.h"
+#include "token.h"
+#include "token_writer.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Lexes one input on several threads. The input is cut into chunks at
+// newlines that look to be outside of comments, and each chunk is lexed by
+// a Lexer of its own. A cut that was in fact inside a comment or literal
+// shows as the last token of the chunk before it running into the chunk's
+// end; the two chunks are then lexed again as one. The tokens, messages
+// and stats come out the same as from a single Lexer over the input.
+class ParallelLexer {
+  public:
+    // input is read in place, as by Lexer
+    ParallelLexer(std::string_view input, bool colored, bool stats, unsigned threads);
+
+    // lexes the whole input, writing the messages to std::cerr in order
+    void run();
+    // the tokens, without the eof one
+    void writeTokens(TokenWriter &writer);
+    void printStat();
+
+  private:
+    struct Chunk {
+        std::string_view text;
+        int firstLine = 1;
+        std::vector<Token> tokens;
+        std::string messages;
+        LexemeTable stat;
+        bool ranIntoEnd = false;
+    };
+
+    void split();
+    void lex(Chunk &chunk);
+
+    std::string_view input_;
+    bool colored_;
+    bool stats_;
+    unsigned threads_;
+    std::vector<Chunk> chunks_;
+};
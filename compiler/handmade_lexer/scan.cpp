@@ -0,0 +1,126 @@
+#include "scan.h"
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LEXER_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace {
+
+bool isSpace(unsigned char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+bool isIdentifierChar(unsigned char c) {
+    return (unsigned)((c | 0x20) - 'a') < 26u || (unsigned)(c - '0') < 10u || c == '_' || c > 127;
+}
+
+#ifdef LEXER_SSE2
+
+int countTrailingZeros(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+int lastSetBit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse(&index, mask);
+    return (int)index;
+#else
+    return 31 - __builtin_clz(mask);
+#endif
+}
+
+int popCount(unsigned mask) {
+#ifdef _MSC_VER
+    return (int)__popcnt(mask);
+#else
+    return __builtin_popcount(mask);
+#endif
+}
+
+// bit i set if byte i of block is a space
+unsigned spaceMask(__m128i block) {
+    __m128i blank = _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+    // '\t' to '\r' are 9 to 13: subtracting 9 leaves them 0 to 4
+    __m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8('\t'));
+    __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted);
+    return (unsigned)_mm_movemask_epi8(_mm_or_si128(blank, control));
+}
+
+unsigned identifierMask(__m128i block) {
+    // lower case the letters, then a-z is a range of 26 from 'a'
+    __m128i letter = _mm_sub_epi8(_mm_or_si128(block, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    letter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(25)), letter);
+    __m128i digit = _mm_sub_epi8(block, _mm_set1_epi8('0'));
+    digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    __m128i underscore = _mm_cmpeq_epi8(block, _mm_set1_epi8('_'));
+    // the sign bit is set for non-ASCII bytes, movemask takes it as is
+    __m128i any = _mm_or_si128(_mm_or_si128(letter, digit), _mm_or_si128(underscore, block));
+    return (unsigned)_mm_movemask_epi8(any);
+}
+
+__m128i load(const char *p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+#endif
+
+} // namespace
+
+const char *skipSpaces(const char *p, const char *end) {
+#ifdef LEXER_SSE2
+    for (; end - p >= 16; p += 16) {
+        unsigned stop = ~spaceMask(load(p)) & 0xffff;
+        if (stop) return p + countTrailingZeros(stop);
+    }
+#endif
+    while (p < end && isSpace(*p)) p++;
+    return p;
+}
+
+const char *skipIdentifierChars(const char *p, const char *end) {
+#ifdef LEXER_SSE2
+    for (; end - p >= 16; p += 16) {
+        unsigned stop = ~identifierMask(load(p)) & 0xffff;
+        if (stop) return p + countTrailingZeros(stop);
+    }
+#endif
+    while (p < end && isIdentifierChar(*p)) p++;
+    return p;
+}
+
+const char *findByte(const char *p, const char *end, char c) {
+    // memchr is vectorized already wherever it matters
+    auto found = static_cast<const char *>(memchr(p, c, end - p));
+    return found ? found : end;
+}
+
+size_t countNewlines(const char *p, const char *end, const char **last) {
+    size_t count = 0;
+#ifdef LEXER_SSE2
+    for (; end - p >= 16; p += 16) {
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(load(p), _mm_set1_epi8('\n')));
+        if (mask) {
+            count += popCount(mask);
+            *last = p + lastSetBit(mask);
+        }
+    }
+#endif
+    for (; p < end; p++) {
+        if (*p == '\n') {
+            count++;
+            *last = p;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+// Bulk scans over the input for the runs the lexer spends most of its time
+// in. Each returns the first byte in [p, end) that ends the run, or end.
+// With SSE2 they look at 16 bytes at a time, otherwise at one.
+
+// ' ', '\t', '\n', '\v', '\f', '\r'
+const char *skipSpaces(const char *p, const char *end);
+// letters, digits, '_' and non-ASCII bytes
+const char *skipIdentifierChars(const char *p, const char *end);
+const char *findByte(const char *p, const char *end, char c);
+
+// the number of '\n' in [p, end), and the last of them in *last, which is
+// left alone if there is none
+size_t countNewlines(const char *p, const char *end, const char **last);
@@ -1,17 +1,36 @@
-#pragma once
-
-#include <string>
-
-struct Token {
-    Token(std::string type, std::string val, int line, int col)
-        : type(type), val(val), line(line), col(col) {}
-
-    void print() {
-        printf("%d:%d: <%s, %s>\n", line, col, type.c_str(), val.c_str());
-    }
-
-    std::string type;
-    std::string val;
-    int line;
-    int col;
-};
+#pragma once
+
+#include <string_view>
+
+enum class TokenType {
+    eof,
+    keyword,
+    identifier,
+    integer_constant,
+    floating_constant,
+    char_constant,
+    string_literal,
+    error_string_literal,
+    punctuator,
+    error,
+};
+const int tokenTypeCount = (int)TokenType::error + 1;
+
+inline const char *tokenTypeName(TokenType type) {
+    static const char *names[] = {
+        "EOF",           "keyword",        "identifier",           "integer constant", "floating constant",
+        "char constant", "string literal", "error string literal", "punctuator",       "error"};
+    return names[(int)type];
+}
+
+// val points into the lexer's input, which has to outlive the token
+struct Token {
+    Token() = default;
+    Token(TokenType type, std::string_view val, int line, int col)
+        : type(type), val(val), line(line), col(col) {}
+
+    TokenType type = TokenType::eof;
+    std::string_view val;
+    int line = 0;
+    int col = 0;
+};
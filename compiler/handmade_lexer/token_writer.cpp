@@ -0,0 +1,67 @@
+#include "token_writer.h"
+#include <charconv>
+#include <cstring>
+
+TokenWriter::TokenWriter(FILE *out, Format format) : out_(out), format_(format), buffer_(64 * 1024) {
+    if (format_ == Format::binary) put("TOK1");
+}
+
+void TokenWriter::write(const Token &token) {
+    if (format_ == Format::binary) {
+        char type = (char)token.type;
+        put(std::string_view(&type, 1));
+        putU32((uint32_t)token.line);
+        putU32((uint32_t)token.col);
+        putU32((uint32_t)token.val.size());
+        put(token.val);
+        return;
+    }
+    putNumber(token.line);
+    put(":");
+    putNumber(token.col);
+    put(": <");
+    put(tokenTypeName(token.type));
+    put(", ");
+    put(token.val);
+    put(">\n");
+}
+
+void TokenWriter::write(const Token *tokens, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        write(tokens[i]);
+    }
+}
+
+void TokenWriter::finish() {
+    if (format_ == Format::binary) write(Token(TokenType::eof, "", 0, 0));
+    flush();
+}
+
+void TokenWriter::flush() {
+    if (size_) fwrite(buffer_.data(), 1, size_, out_);
+    size_ = 0;
+}
+
+void TokenWriter::put(std::string_view bytes) {
+    if (buffer_.size() - size_ < bytes.size()) {
+        flush();
+        // a lexeme longer than the buffer goes out as it is
+        if (bytes.size() > buffer_.size()) {
+            fwrite(bytes.data(), 1, bytes.size(), out_);
+            return;
+        }
+    }
+    memcpy(buffer_.data() + size_, bytes.data(), bytes.size());
+    size_ += bytes.size();
+}
+
+void TokenWriter::putNumber(int n) {
+    char digits[16];
+    auto result = std::to_chars(digits, digits + sizeof digits, n);
+    put(std::string_view(digits, result.ptr - digits));
+}
+
+void TokenWriter::putU32(uint32_t n) {
+    char bytes[4] = {(char)(n & 0xff), (char)(n >> 8 & 0xff), (char)(n >> 16 & 0xff), (char)(n >> 24)};
+    put(std::string_view(bytes, 4));
+}
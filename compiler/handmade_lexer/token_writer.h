@@ -0,0 +1,42 @@
+#pragma once
+
+#include "token.h"
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <vector>
+
+// Writes tokens to a file through a buffer of its own, formatting them by
+// hand rather than with a printf per token.
+//
+// As text, a token is a line "line:col: <type name, lexeme>".
+// As binary, for other programs to read, the stream starts with "TOK1" and
+// each token is
+//   u8 type, u32 line, u32 col, u32 length, then length bytes of lexeme
+// with the numbers little-endian and type the value of TokenType. It ends
+// with an eof token, of length 0.
+class TokenWriter {
+  public:
+    enum class Format { text, binary };
+
+    TokenWriter(FILE *out, Format format);
+    ~TokenWriter() { flush(); }
+    TokenWriter(const TokenWriter &) = delete;
+    TokenWriter &operator=(const TokenWriter &) = delete;
+
+    void write(const Token &token);
+    void write(const Token *tokens, size_t count);
+    // ends the stream, after which nothing more is written
+    void finish();
+    void flush();
+
+  private:
+    void put(std::string_view bytes);
+    void putNumber(int n);
+    void putU32(uint32_t n);
+
+    FILE *out_;
+    Format format_;
+    std::vector<char> buffer_;
+    size_t size_ = 0;
+};
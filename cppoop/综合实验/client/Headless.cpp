@@ -0,0 +1,452 @@
+#include "Headless.h"
+#include "Socket.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <csignal>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+const auto replyTimeout = std::chrono::seconds(10);
+const int prefetchDepth = 2;
+
+// a server started for the run, in a directory of its own
+class ServerProcess {
+  public:
+    ~ServerProcess() { stop(); }
+
+    void start(const std::string &path, const std::string &port, const std::filesystem::path &dir) {
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+#ifdef _WIN32
+        STARTUPINFOA startupInfo{sizeof(startupInfo)};
+        std::string commandLine = "\"" + path + "\" --port " + port;
+        if (!CreateProcessA(nullptr, commandLine.data(), nullptr, nullptr, FALSE, 0, nullptr,
+                            dir.string().c_str(), &startupInfo, &m_process)) {
+            throw std::runtime_error("cannot start " + path);
+        }
+        m_running = true;
+#else
+        std::string log = (dir / "server.log").string();
+        m_pid = fork();
+        if (m_pid == 0) {
+            int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            if (chdir(dir.c_str()) == 0) {
+                execl(path.c_str(), path.c_str(), "--port", port.c_str(), (char *)nullptr);
+            }
+            _exit(127);
+        }
+        if (m_pid < 0) {
+            throw std::runtime_error("cannot start " + path);
+        }
+        m_running = true;
+#endif
+        m_dir = dir;
+    }
+
+    void stop() {
+        if (!m_running) return;
+        m_running = false;
+#ifdef _WIN32
+        TerminateProcess(m_process.hProcess, 0);
+        WaitForSingleObject(m_process.hProcess, INFINITE);
+        CloseHandle(m_process.hProcess);
+        CloseHandle(m_process.hThread);
+#else
+        kill(m_pid, SIGTERM);
+        waitpid(m_pid, nullptr, 0);
+#endif
+        std::error_code ec;
+        std::filesystem::remove_all(m_dir, ec);
+    }
+
+  private:
+    bool m_running = false;
+    std::filesystem::path m_dir;
+#ifdef _WIN32
+    PROCESS_INFORMATION m_process{};
+#else
+    pid_t m_pid = -1;
+#endif
+};
+
+// round trip times in milliseconds, by request type
+class Timings {
+  public:
+    void record(const std::string &type, double ms) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_samples[type].push_back(ms);
+        std::printf("%-16s %9.3f\n", type.c_str(), ms);
+    }
+
+    // prints a summary and returns whether every p95 is within budget
+    bool report(double budget) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        bool ok = true;
+        std::printf("\n%-16s %6s %9s %9s %9s %9s\n", "type", "count", "mean", "p50", "p95", "max");
+        for (auto &[type, samples] : m_samples) {
+            std::sort(samples.begin(), samples.end());
+            double sum = 0;
+            for (double ms : samples) sum += ms;
+            double p95 = percentile(samples, 0.95);
+            std::printf("%-16s %6zu %9.3f %9.3f %9.3f %9.3f\n", type.c_str(), samples.size(), sum / samples.size(),
+                        percentile(samples, 0.5), p95, samples.back());
+            if (budget > 0 && p95 > budget) {
+                std::printf("%s: p95 %.3f ms is over the budget of %.3f ms\n", type.c_str(), p95, budget);
+                ok = false;
+            }
+        }
+        return ok;
+    }
+
+  private:
+    static double percentile(const std::vector<double> &sorted, double p) {
+        return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+    }
+
+    std::mutex m_mutex;
+    std::map<std::string, std::vector<double>> m_samples;
+};
+
+static double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// One logged in player. Socket handlers run on its io thread, and the
+// scenario waits for them, so the calls below block like a user would.
+class Player {
+  public:
+    Player(const std::string &server, Timings &timings) : m_timings(timings) {
+        std::promise<bool> connected;
+        m_socket.connect(server, [&](bool ok) { connected.set_value(ok); });
+        if (!connected.get_future().get()) {
+            throw std::runtime_error("cannot connect to " + server);
+        }
+        m_socket.listen({"next_problem"}, [this](const std::string &type, std::istringstream &is) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_upcoming.push_back(is.str());
+            m_changed.notify_all();
+        });
+    }
+
+    ~Player() {
+        m_socket.disconnect();
+    }
+
+    void send(const std::string &msg) {
+        m_socket.send(msg);
+    }
+
+    // sends msg now, the reply is waited for with get()
+    std::shared_future<std::string> requestAsync(const std::string &msg, std::vector<std::string> types) {
+        auto reply = std::make_shared<std::promise<std::string>>();
+        std::string type = msg.substr(0, msg.find('\n'));
+        auto start = Clock::now();
+        m_socket.request(msg, types, [this, reply, type, start](const std::string &, std::istringstream &is) {
+            m_timings.record(type, msSince(start));
+            reply->set_value(is.str());
+        });
+        return reply->get_future().share();
+    }
+
+    std::string request(const std::string &msg, std::vector<std::string> types) {
+        return get(requestAsync(msg, types), msg.substr(0, msg.find('\n')));
+    }
+
+    // waits for a message the server sends unprompted
+    std::string expect(std::vector<std::string> types) {
+        auto reply = std::make_shared<std::promise<std::string>>();
+        m_socket.expect(types, [reply](const std::string &, std::istringstream &is) {
+            reply->set_value(is.str());
+        });
+        return get(reply->get_future().share(), types.front());
+    }
+
+    // the next problem sent ahead with next_problem
+    std::string nextProblem() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_changed.wait_for(lock, replyTimeout, [this] { return !m_upcoming.empty(); })) {
+            throw std::runtime_error("no next_problem");
+        }
+        std::string msg = m_upcoming.front();
+        m_upcoming.pop_front();
+        return msg;
+    }
+
+    void clearUpcoming() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_upcoming.clear();
+    }
+
+  private:
+    static std::string get(std::shared_future<std::string> reply, const std::string &what) {
+        if (reply.wait_for(replyTimeout) != std::future_status::ready) {
+            throw std::runtime_error("no reply to " + what);
+        }
+        return reply.get();
+    }
+
+    Timings &m_timings;
+    Socket m_socket;
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::deque<std::string> m_upcoming;
+};
+
+// the fields of a message after its type line
+static std::istringstream body(const std::string &msg) {
+    std::istringstream is(msg);
+    std::string type;
+    std::getline(is, type);
+    return is;
+}
+
+struct Problem {
+    std::string word;
+    int level = 0, round = 0, totalRound = 0, timeLimit = 0;
+};
+
+static Problem readProblem(const std::string &msg) {
+    auto is = body(msg);
+    Problem problem;
+    std::getline(is, problem.word);
+    is >> problem.level >> problem.round >> problem.totalRound >> problem.timeLimit;
+    return problem;
+}
+
+static void checkSuccess(const std::string &msg) {
+    auto is = body(msg);
+    std::string result;
+    std::getline(is, result);
+    if (result != "success") {
+        throw std::runtime_error(msg.substr(0, msg.find('\n')) + ": " + result);
+    }
+}
+
+class Scenario {
+  public:
+    Scenario(const std::string &server, Timings &timings) : m_server(server), m_timings(timings) {}
+
+    void run(const std::vector<std::string> &args) {
+        const std::string &command = args[0];
+        if (command == "signup" && args.size() == 4) {
+            checkSuccess(player().request("signup\n" + args[3] + "\n" + args[1] + "\n" + args[2] + "\n", {"signup_res"}));
+        } else if (command == "login" && args.size() == 3) {
+            login(player(), args[1], args[2]);
+        } else if (command == "logout" && args.size() == 1) {
+            player().send("logout\n");
+        } else if (command == "make" && args.size() == 2) {
+            checkSuccess(player().request("make_problem\n" + args[1] + "\n", {"make_problem_res"}));
+        } else if (command == "make" && args.size() > 2) {
+            makeBatch(std::vector<std::string>(args.begin() + 1, args.end()));
+        } else if (command == "play" && args.size() == 2) {
+            play(std::stoi(args[1]));
+        } else if (command == "rank" && args.size() == 1) {
+            rank();
+        } else if (command == "battle" && args.size() == 4) {
+            battle(args[1], args[2], std::stoi(args[3]));
+        } else {
+            throw std::runtime_error("bad command " + command);
+        }
+    }
+
+  private:
+    void makeBatch(const std::vector<std::string> &words) {
+        std::string msg = "make_problems\n" + std::to_string(words.size()) + "\n";
+        for (const auto &word : words) {
+            msg += word + "\n";
+        }
+        std::string reply = player().request(msg, {"make_problems_res"});
+        checkSuccess(reply);
+        auto is = body(reply);
+        std::string line;
+        std::getline(is, line);
+        std::getline(is, line);
+        for (const auto &word : words) {
+            std::getline(is, line);
+            if (line != "success") {
+                throw std::runtime_error("make_problems: " + word + ": " + line);
+            }
+        }
+    }
+
+    Player &player() {
+        if (!m_player) m_player = std::make_unique<Player>(m_server, m_timings);
+        return *m_player;
+    }
+
+    static void login(Player &player, const std::string &name, const std::string &password) {
+        checkSuccess(player.request("login\n" + name + "\n" + password + "\n", {"login_res"}));
+    }
+
+    // answers every round of the first levels correctly, like PlayPage
+    void play(int levels) {
+        Player &p = player();
+        p.clearUpcoming();
+        Problem problem = readProblem(p.request("play\n" + std::to_string(prefetchDepth) + "\n", {"problem"}));
+        while (true) {
+            std::string result = p.request("submit\n" + problem.word + "\n", {"result"});
+            auto is = body(result);
+            int solved, value, delay;
+            is >> solved;
+            for (int i = 0; i < 7; i++) is >> value;
+            if (solved != 1) throw std::runtime_error("wrong answer to " + problem.word);
+            if (problem.level == levels && problem.round == problem.totalRound) break;
+
+            // how long the next problem kept us waiting, apart from the delay
+            auto start = Clock::now();
+            if (is >> delay) {
+                problem = readProblem(p.nextProblem());
+                m_timings.record("next_problem", msSince(start));
+                std::this_thread::sleep_for(delay * std::chrono::milliseconds(100));
+            } else {
+                problem = readProblem(p.expect({"problem"}));
+                m_timings.record("next_problem", msSince(start));
+            }
+        }
+        p.send("exit\n");
+    }
+
+    // the first two pages of each list, like scrolling RankPage
+    void rank() {
+        for (int type = 1; type <= 2; type++) {
+            for (int offset = 0; offset < 100; offset += 50) {
+                player().request("userlist_page\n" + std::to_string(type) + "\n1 0\n0\n\n"
+                                     + std::to_string(offset) + " 50\n",
+                                 {"userlist_page_res"});
+            }
+        }
+    }
+
+    // Battles another player who is logged in on a second connection. This
+    // player answers every round, the opponent only polls, like BattlePage.
+    void battle(const std::string &opponentName, const std::string &password, int rounds) {
+        if (rounds < 1 || rounds > 9) throw std::runtime_error("battle rounds must be 1 to 9");
+        Player &p = player();
+        Player opponent(m_server, m_timings);
+        login(opponent, opponentName, password);
+
+        p.send("start_match\n");
+        opponent.send("start_match\n");
+        for (Player *side : {&p, &opponent}) {
+            for (int i = 0;; i++) {
+                auto is = body(side->request("poll_match\n", {"match_res"}));
+                int matched = 0;
+                is >> matched;
+                if (matched) break;
+                if (i == 100) throw std::runtime_error("no match");
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        }
+
+        auto ready = p.requestAsync("battle_ready\n", {"problem"});
+        auto opponentReady = opponent.requestAsync("battle_ready\n", {"problem"});
+        if (ready.wait_for(replyTimeout) != std::future_status::ready
+            || opponentReady.wait_for(replyTimeout) != std::future_status::ready) {
+            throw std::runtime_error("no reply to battle_ready");
+        }
+        Problem problem = readProblem(ready.get());
+        for (int round = 1; round <= rounds; round++) {
+            p.send("submit\n" + problem.word + "\n");
+            for (Player *side : {&p, &opponent}) {
+                for (int i = 0;; i++) {
+                    std::string msg = side->request("poll_result\n", {"battle_result", "no_battle_result"});
+                    if (msg.rfind("battle_result\n", 0) == 0) break;
+                    if (i == 100) throw std::runtime_error("no battle_result");
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                }
+            }
+            // each poll answered with a result is followed by the next problem
+            problem = readProblem(p.expect({"problem"}));
+            opponent.expect({"problem"});
+        }
+        p.send("exit\n");
+        opponent.send("exit\n");
+        opponent.send("logout\n");
+    }
+
+    std::string m_server;
+    Timings &m_timings;
+    std::unique_ptr<Player> m_player;
+};
+
+static bool waitForServer(const std::string &server) {
+    for (int i = 0; i < 50; i++) {
+        Socket socket;
+        std::promise<bool> connected;
+        socket.connect(server, [&](bool ok) { connected.set_value(ok); });
+        if (connected.get_future().get()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return false;
+}
+
+int runHeadless(int argc, const char *argv[]) {
+    std::string scenarioPath, serverPath, server = "127.0.0.1:1764", port;
+    double budget = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--headless" && i + 1 < argc) scenarioPath = argv[++i];
+        else if (arg == "--connect" && i + 1 < argc) server = argv[++i];
+        else if (arg == "--server" && i + 1 < argc) serverPath = argv[++i];
+        else if (arg == "--port" && i + 1 < argc) port = argv[++i];
+        else if (arg == "--budget" && i + 1 < argc) budget = std::stod(argv[++i]);
+    }
+    std::ifstream scenarioFile(scenarioPath);
+    if (!scenarioFile) {
+        std::fprintf(stderr, "cannot open scenario %s\n", scenarioPath.c_str());
+        return 2;
+    }
+
+    ServerProcess serverProcess;
+    if (!serverPath.empty()) {
+        if (port.empty()) port = "1764";
+        server = "127.0.0.1:" + port;
+        serverProcess.start(serverPath, port, std::filesystem::temp_directory_path() / ("headless-server-" + port));
+        if (!waitForServer(server)) {
+            std::fprintf(stderr, "server did not start\n");
+            return 1;
+        }
+    }
+
+    Timings timings;
+    int lineNumber = 0;
+    try {
+        Scenario scenario(server, timings);
+        std::string line;
+        while (std::getline(scenarioFile, line)) {
+            lineNumber++;
+            std::istringstream is(line);
+            std::vector<std::string> args;
+            std::string arg;
+            while (is >> arg) args.push_back(arg);
+            if (args.empty() || args[0][0] == '#') continue;
+            scenario.run(args);
+        }
+        // the scenario's connections close here, before the server stops,
+        // so that the server's port is not left in TIME_WAIT
+    } catch (std::exception &e) {
+        std::fprintf(stderr, "%s:%d: %s\n", scenarioPath.c_str(), lineNumber, e.what());
+        return 1;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    serverProcess.stop();
+    return timings.report(budget) ? 0 : 1;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// Runs a scenario script against a server without a terminal, playing the
+// protocol the way the pages do and printing how long each round trip took:
+//   client --headless <scenario> [--connect <host:port>]
+//          [--server <server executable> --port <port>] [--budget <ms>]
+// With --server a fresh server is started in a temporary directory. With
+// --budget the run fails if the 95th percentile of any request type's round
+// trips is slower than that.
+int runHeadless(int argc, const char *argv[]);
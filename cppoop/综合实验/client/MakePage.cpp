@@ -1,71 +1,118 @@
-#include "GlobalContext.h"
-#include "ui.h"
-
-using namespace ftxui;
-
-class MakePageBase : public PageBase {
-  public:
-    MakePageBase(GlobalContext &ctx) : PageBase(ctx) {
-        InputOption inputOption;
-        inputOption.on_enter = std::bind(&MakePageBase::submit, this);
-        m_input = Input(&m_inputText, "输入单词", inputOption);
-
-        ButtonOption option = ButtonOption::Ascii();
-
-        auto buttonSubmit = Button(
-            "提交", std::bind(&MakePageBase::submit, this), option);
-
-        auto buttonBack = Button(
-            "退出", [&] { switchPage(MainPage(m_ctx)); }, option);
-        m_buttons = Container::Horizontal({buttonSubmit, buttonBack});
-
-        Add(Container::Vertical({m_input, m_buttons}));
-    }
-
-  private:
-    Element Render() override {
-        std::string info = " " + std::to_string(m_ctx.user.level) + "级 出题数"
-                         + std::to_string(m_ctx.user.madeNum)
-                         + "/" + std::to_string(m_ctx.user.madeNumForNextLevel) + " ";
-        return vbox({text(info),
-                     filler(),
-                     m_input->Render() | size(WIDTH, GREATER_THAN, 20) | hcenter,
-                     filler(),
-                     m_buttons->Render() | hcenter,
-                     filler()})
-             | size(WIDTH, EQUAL, 90)
-             | size(HEIGHT, EQUAL, 30)
-             | border;
-    }
-
-    void submit() {
-        if (m_inputText.empty()) {
-            alert("单词不能为空");
-            return;
-        }
-
-        m_socket.write("make_problem\n"
-                      + m_inputText + "\n");
-        auto is = m_socket.readStream();
-        std::string line;
-        std::getline(is, line);
-        std::getline(is, line);
-        if (line == "success") {
-            alert("提交成功");
-            m_inputText.clear();
-            m_input->TakeFocus();
-        } else {
-            alert(line);
-        }
-        is >> m_ctx.user.level
-            >> m_ctx.user.madeNum
-            >> m_ctx.user.madeNumForNextLevel;
-    }
-
-    std::string m_inputText;
-    Component m_input, m_buttons;
-};
-
-Component MakePage(GlobalContext &ctx) {
-    return Make<MakePageBase>(ctx);
-}
+#include "GlobalContext.h"
+#include "ui.h"
+#include <sstream>
+
+using namespace ftxui;
+
+class MakePageBase : public PageBase {
+  public:
+    MakePageBase(GlobalContext &ctx) : PageBase(ctx) {
+        InputOption inputOption;
+        inputOption.on_enter = std::bind(&MakePageBase::submit, this);
+        m_input = Input(&m_inputText, "输入单词，多个以空格分隔", inputOption);
+
+        ButtonOption option = ButtonOption::Ascii();
+
+        auto buttonSubmit = Button(
+            "提交", std::bind(&MakePageBase::submit, this), option);
+
+        auto buttonBack = Button(
+            "退出", [&] { switchPage(MainPage(m_ctx)); }, option);
+        m_buttons = Container::Horizontal({buttonSubmit, buttonBack});
+
+        Add(Container::Vertical({m_input, m_buttons}));
+    }
+
+  private:
+    Element Render() override {
+        std::string info = " " + std::to_string(m_ctx.user.level) + "级 出题数"
+                         + std::to_string(m_ctx.user.madeNum)
+                         + "/" + std::to_string(m_ctx.user.madeNumForNextLevel) + " ";
+        return vbox({text(info),
+                     filler(),
+                     m_input->Render() | size(WIDTH, GREATER_THAN, 20) | hcenter,
+                     filler(),
+                     m_buttons->Render() | hcenter,
+                     filler()})
+             | size(WIDTH, EQUAL, 90)
+             | size(HEIGHT, EQUAL, 30)
+             | border;
+    }
+
+    void submit() {
+        std::vector<std::string> words;
+        std::istringstream split(m_inputText);
+        for (std::string word; split >> word;) {
+            words.push_back(word);
+        }
+        if (words.empty()) {
+            alert("单词不能为空");
+            return;
+        }
+        if (words.size() > 1) {
+            submitBatch(words);
+            return;
+        }
+
+        request("make_problem\n"
+                    + words[0] + "\n",
+                {"make_problem_res"}, [this](const std::string &type, std::istringstream &is) {
+                    std::string line;
+                    std::getline(is, line);
+                    if (line == "success") {
+                        alert("提交成功");
+                        m_inputText.clear();
+                        m_input->TakeFocus();
+                    } else {
+                        alert(line);
+                    }
+                    is >> m_ctx.user.level
+                        >> m_ctx.user.madeNum
+                        >> m_ctx.user.madeNumForNextLevel;
+                });
+    }
+
+    void submitBatch(const std::vector<std::string> &words) {
+        std::string msg = "make_problems\n" + std::to_string(words.size()) + "\n";
+        for (const auto &word : words) {
+            msg += word + "\n";
+        }
+        request(msg, {"make_problems_res"}, [this, words](const std::string &type, std::istringstream &is) {
+            std::string line;
+            std::getline(is, line);
+            if (line != "success") {
+                alert(line);
+            } else {
+                // the words that failed stay in the input to be fixed
+                int n = 0;
+                is >> n;
+                std::getline(is, line);
+                std::string failed, firstError;
+                for (int i = 0; i < n && i < (int)words.size(); i++) {
+                    std::getline(is, line);
+                    if (line != "success") {
+                        failed += (failed.empty() ? "" : " ") + words[i];
+                        if (firstError.empty()) firstError = words[i] + ": " + line;
+                    }
+                }
+                if (failed.empty()) {
+                    alert("提交成功");
+                } else {
+                    alert(firstError);
+                }
+                m_inputText = failed;
+                m_input->TakeFocus();
+            }
+            is >> m_ctx.user.level
+                >> m_ctx.user.madeNum
+                >> m_ctx.user.madeNumForNextLevel;
+        });
+    }
+
+    std::string m_inputText;
+    Component m_input, m_buttons;
+};
+
+Component MakePage(GlobalContext &ctx) {
+    return Make<MakePageBase>(ctx);
+}
@@ -1,191 +1,222 @@
-#include "GlobalContext.h"
-#include "ui.h"
-#include <thread>
-
-using namespace ftxui;
-
-class PlayPageBase : public PageBase {
-  public:
-    PlayPageBase(GlobalContext &ctx) : PageBase(ctx) {
-        InputOption inputOption;
-        inputOption.on_enter = std::bind(&PlayPageBase::submit, this);
-        m_input = Input(&m_inputText, "输入单词", inputOption);
-
-        m_input |= Maybe([&] { return m_state == State::input; });
-
-        ButtonOption option = ButtonOption::Ascii();
-
-        auto buttonSubmit = Button(
-            "提交", std::bind(&PlayPageBase::submit, this), option);
-        buttonSubmit |= Maybe([&] { return m_state == State::input; });
-
-        auto buttonRetry = Button(
-            "重试本关", std::bind(&PlayPageBase::retry, this), option);
-        buttonRetry |= Maybe([&] { return m_state == State::fail; });
-
-        auto buttonBack = Button(
-            "退出", [&] {
-                m_socket.write("exit\n");
-                *m_exit = true;
-                switchPage(MainPage(m_ctx));
-            },
-            option);
-
-        m_buttons = Container::Horizontal({buttonSubmit,
-                                           buttonRetry,
-                                           buttonBack});
-
-        Add(Container::Vertical({m_input, m_buttons}));
-
-        start();
-    }
-
-  private:
-    Element Render() override {
-        auto header = hbox({text(" " + std::to_string(m_ctx.user.level) + "级"
-                                 + " 经验" + std::to_string(m_ctx.user.exp)
-                                 + "/" + std::to_string(m_ctx.user.expForNextLevel) + " ["),
-                            gauge((float)m_ctx.user.exp / m_ctx.user.expForNextLevel),
-                            text("] 共通过" + std::to_string(m_ctx.user.levelPassed) + "个关卡 ")});
-
-        Element tip;
-        Element content;
-        if (m_state == State::show) {
-            tip = text("");
-            content = text(m_word);
-        } else if (m_state == State::input) {
-            tip = text("");
-            content = m_input->Render() | size(WIDTH, GREATER_THAN, 1);
-        } else {
-            content = text(m_inputText);
-            if (m_state == State::correct) {
-                if (m_expGained) {
-                    tip = text("通过本关，耗时 "
-                               + std::to_string(m_duration / 10) + "." + std::to_string(m_duration % 10) + " 秒，获得 "
-                               + std::to_string(m_expGained) + " 经验");
-                } else {
-                    tip = text("答案正确");
-                }
-                content |= color(Color::Green);
-
-            } else if (m_state == State::fail) {
-                tip = text("答案错误，正确答案为 " + m_word + " 你还有" + std::to_string(m_retry) + "次重试机会");
-                content |= color(Color::Red);
-            }
-        }
-
-        return vbox({
-                   header,
-                   text("第 " + std::to_string(m_level) + " 关，第 " + std::to_string(m_round) + "/" + std::to_string(m_totalRound) + " 轮") | hcenter,
-                   filler(),
-                   text(m_countdown ? "倒计时 " + std::to_string(m_countdown / 10) + "." + std::to_string(m_countdown % 10) + " 秒" : "请输入") | hcenter,
-                   filler(),
-                   tip | hcenter,
-                   content | hcenter,
-                   filler(),
-                   m_buttons->Render() | hcenter,
-                   filler(),
-               })
-             | size(WIDTH, EQUAL, 90)
-             | size(HEIGHT, EQUAL, 30)
-             | border;
-    }
-
-    bool OnEvent(Event event) override {
-        if (event == Event::Custom) {
-            if (m_countdown > 0) {
-                m_countdown--;
-                if (m_countdown == 0) {
-                    m_state = State::input;
-                    m_inputText.clear();
-                    m_input->TakeFocus();
-                }
-            }
-            return true;
-        } else if (event.input() == "get_problem") {
-            getProblem();
-        } else {
-            return PageBase::OnEvent(event);
-        }
-    }
-
-    void getProblem() {
-        auto is = m_socket.readStream();
-        std::string line;
-        std::getline(is, line);
-        std::getline(is, line);
-        m_word = line;
-        is >> m_level >> m_round >> m_totalRound >> m_countdown;
-        m_state = State::show;
-        std::thread([timeLimit = m_countdown, &screen = m_ctx.screen, exit = m_exit] {
-            for (int i = 0; i < timeLimit; i++) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                if (*exit) return;
-                screen.PostEvent(Event::Custom);
-            }
-        }).detach();
-    }
-
-    void start() {
-        m_socket.write("play\n");
-        getProblem();
-    }
-
-    void retry() {
-        if (m_retry > 0) {
-            m_retry--;
-            m_socket.write("retry\n");
-            getProblem();
-        } else {
-            alert("重试次数已用完");
-        }
-    }
-
-    void submit() {
-        if (m_inputText.empty()) return;
-        m_socket.write("submit\n"
-                       + m_inputText + "\n");
-
-        auto is = m_socket.readStream();
-        std::string line;
-        std::getline(is, line);
-        int result;
-        is >> result
-            >> m_duration >> m_expGained >> m_retry
-            >> m_ctx.user.level
-            >> m_ctx.user.exp
-            >> m_ctx.user.expForNextLevel
-            >> m_ctx.user.levelPassed;
-
-        if (result) {
-            m_state = State::correct;
-            std::thread([this] {
-                std::this_thread::sleep_for(std::chrono::milliseconds(500));
-                m_ctx.screen.PostEvent(Event::Special("get_problem"));
-            }).detach();
-
-        } else {
-            m_state = State::fail;
-        }
-    }
-
-    enum class State {
-        show,
-        input,
-        correct,
-        fail
-    };
-
-    State m_state;
-    std::string m_word;
-    int m_countdown;
-    int m_duration, m_expGained;
-    int m_level, m_round, m_totalRound, m_retry;
-    std::string m_inputText;
-    Component m_input, m_buttons;
-    std::shared_ptr<std::atomic_bool> m_exit = std::make_shared<std::atomic_bool>(false);
-};
-
-Component PlayPage(GlobalContext &ctx) {
-    return Make<PlayPageBase>(ctx);
-}
+#include "GlobalContext.h"
+#include "ui.h"
+
+using namespace ftxui;
+
+// problems the server sends ahead of the rounds they are for
+const int prefetchDepth = 2;
+
+class PlayPageBase : public PageBase {
+  public:
+    PlayPageBase(GlobalContext &ctx) : PageBase(ctx) {
+        InputOption inputOption;
+        inputOption.on_enter = std::bind(&PlayPageBase::submit, this);
+        m_input = Input(&m_inputText, "输入单词", inputOption);
+
+        m_input |= Maybe([&] { return m_state == State::input; });
+
+        ButtonOption option = ButtonOption::Ascii();
+
+        auto buttonSubmit = Button(
+            "提交", std::bind(&PlayPageBase::submit, this), option);
+        buttonSubmit |= Maybe([&] { return m_state == State::input; });
+
+        auto buttonRetry = Button(
+            "重试本关", std::bind(&PlayPageBase::retry, this), option);
+        buttonRetry |= Maybe([&] { return m_state == State::fail; });
+
+        auto buttonBack = Button(
+            "退出", [&] {
+                m_socket.send("exit\n");
+                switchPage(MainPage(m_ctx));
+            },
+            option);
+
+        m_buttons = Container::Horizontal({buttonSubmit,
+                                           buttonRetry,
+                                           buttonBack});
+
+        Add(Container::Vertical({m_input, m_buttons}));
+
+        start();
+    }
+
+  private:
+    Element Render() override {
+        auto header = hbox({text(" " + std::to_string(m_ctx.user.level) + "级"
+                                 + " 经验" + std::to_string(m_ctx.user.exp)
+                                 + "/" + std::to_string(m_ctx.user.expForNextLevel) + " ["),
+                            gauge((float)m_ctx.user.exp / m_ctx.user.expForNextLevel),
+                            text("] 共通过" + std::to_string(m_ctx.user.levelPassed) + "个关卡 ")});
+
+        Element tip;
+        Element content;
+        if (m_state == State::loading) {
+            tip = text("");
+            content = text("加载中...");
+        } else if (m_state == State::show) {
+            tip = text("");
+            content = text(m_word);
+        } else if (m_state == State::input) {
+            tip = text("");
+            content = m_input->Render() | size(WIDTH, GREATER_THAN, 1);
+        } else {
+            tip = text("");
+            content = text(m_inputText);
+            if (m_state == State::correct) {
+                if (m_expGained) {
+                    tip = text("通过本关，耗时 "
+                               + std::to_string(m_duration / 10) + "." + std::to_string(m_duration % 10) + " 秒，获得 "
+                               + std::to_string(m_expGained) + " 经验");
+                } else {
+                    tip = text("答案正确");
+                }
+                content |= color(Color::Green);
+
+            } else if (m_state == State::fail) {
+                tip = text("答案错误，正确答案为 " + m_word + " 你还有" + std::to_string(m_retry) + "次重试机会");
+                content |= color(Color::Red);
+            }
+        }
+
+        return vbox({
+                   header,
+                   text("第 " + std::to_string(m_level) + " 关，第 " + std::to_string(m_round) + "/" + std::to_string(m_totalRound) + " 轮") | hcenter,
+                   filler(),
+                   text(m_countdown ? "倒计时 " + std::to_string(m_countdown / 10) + "." + std::to_string(m_countdown % 10) + " 秒" : "请输入") | hcenter,
+                   filler(),
+                   tip | hcenter,
+                   content | hcenter,
+                   filler(),
+                   m_buttons->Render() | hcenter,
+                   filler(),
+               })
+             | size(WIDTH, EQUAL, 90)
+             | size(HEIGHT, EQUAL, 30)
+             | border;
+    }
+
+    void tick() {
+        // count from the deadline, since ticks may be late
+        auto left = m_deadline - std::chrono::steady_clock::now();
+        m_countdown = (int)((left + std::chrono::milliseconds(99)) / std::chrono::milliseconds(100));
+        if (m_countdown <= 0) {
+            m_countdown = 0;
+            cancel(m_countdownTimer);
+            m_state = State::input;
+            m_inputText.clear();
+            m_input->TakeFocus();
+        }
+    }
+
+    struct Problem {
+        std::string word;
+        int level, round, totalRound, timeLimit;
+    };
+
+    static Problem readProblem(std::istringstream &is) {
+        Problem problem;
+        std::getline(is, problem.word);
+        is >> problem.level >> problem.round >> problem.totalRound >> problem.timeLimit;
+        return problem;
+    }
+
+    void getProblem(const std::string &type, std::istringstream &is) {
+        // a problem sent now starts over, the ones sent ahead are void
+        m_upcoming.clear();
+        showProblem(readProblem(is));
+    }
+
+    void getNextProblem(const std::string &type, std::istringstream &is) {
+        m_upcoming.push_back(readProblem(is));
+    }
+
+    void showProblem(const Problem &problem) {
+        m_word = problem.word;
+        m_level = problem.level;
+        m_round = problem.round;
+        m_totalRound = problem.totalRound;
+        m_countdown = problem.timeLimit;
+        m_state = State::show;
+        m_deadline = std::chrono::steady_clock::now() + m_countdown * std::chrono::milliseconds(100);
+        cancel(m_countdownTimer);
+        m_countdownTimer = every(std::chrono::milliseconds(100), std::bind(&PlayPageBase::tick, this));
+    }
+
+    void start() {
+        listen({"next_problem"}, std::bind(&PlayPageBase::getNextProblem, this, std::placeholders::_1, std::placeholders::_2));
+        request("play\n" + std::to_string(prefetchDepth) + "\n1\n", {"problem"},
+                std::bind(&PlayPageBase::getProblem, this, std::placeholders::_1, std::placeholders::_2));
+    }
+
+    void retry() {
+        if (m_retry > 0) {
+            m_retry--;
+            m_state = State::loading;
+            request("retry\n", {"problem"}, std::bind(&PlayPageBase::getProblem, this, std::placeholders::_1, std::placeholders::_2));
+        } else {
+            alert("重试次数已用完");
+        }
+    }
+
+    void submit() {
+        if (m_inputText.empty() || m_state != State::input) return;
+        m_state = State::submitted;
+        request("submit\n"
+                    + m_inputText + "\n",
+                {"result"}, std::bind(&PlayPageBase::onResult, this, std::placeholders::_1, std::placeholders::_2));
+    }
+
+    void onResult(const std::string &type, std::istringstream &is) {
+        int result;
+        is >> result
+            >> m_duration >> m_expGained >> m_retry
+            >> m_ctx.user.level
+            >> m_ctx.user.exp
+            >> m_ctx.user.expForNextLevel
+            >> m_ctx.user.levelPassed;
+
+        if (result) {
+            m_state = State::correct;
+            // with a delay the next problem is one sent ahead, else the server sends it
+            int delay;
+            if (is >> delay && !m_upcoming.empty()) {
+                after(delay * std::chrono::milliseconds(100), [this] {
+                    Problem problem = m_upcoming.front();
+                    m_upcoming.pop_front();
+                    showProblem(problem);
+                });
+            } else {
+                after(std::chrono::milliseconds(500), [this] {
+                    expect({"problem"}, std::bind(&PlayPageBase::getProblem, this, std::placeholders::_1, std::placeholders::_2));
+                });
+            }
+        } else {
+            m_state = State::fail;
+        }
+    }
+
+    enum class State {
+        loading,
+        show,
+        input,
+        submitted,
+        correct,
+        fail
+    };
+
+    State m_state = State::loading;
+    std::string m_word;
+    int m_countdown = 0;
+    std::chrono::steady_clock::time_point m_deadline;
+    int m_countdownTimer = -1;
+    int m_duration, m_expGained;
+    int m_level = 0, m_round = 0, m_totalRound = 0, m_retry = 0;
+    std::deque<Problem> m_upcoming;
+    std::string m_inputText;
+    Component m_input, m_buttons;
+};
+
+Component PlayPage(GlobalContext &ctx) {
+    return Make<PlayPageBase>(ctx);
+}
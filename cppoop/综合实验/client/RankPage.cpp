@@ -1,126 +1,233 @@
-#include "GlobalContext.h"
-#include "scroller.hpp"
-#include "ui.h"
-#include <ftxui/dom/elements.hpp> // for color, Fit, LIGHT, align_right, bold, DOUBLE
-#include <ftxui/dom/table.hpp>    // for Table, TableSelection
-
-using namespace ftxui;
-
-class RankPageBase : public PageBase {
-  public:
-    RankPageBase(GlobalContext &ctx) : PageBase(ctx) {
-        auto buttonBack = Button(
-            "返回", [&] { switchPage(MainPage(ctx)); }, ButtonOption::Ascii());
-
-        m_bottomButtons = Container::Horizontal({buttonBack});
-
-        m_socket.write("userlist\n");
-        auto is = m_socket.readStream();
-        std::string _;
-        std::getline(is, _);
-        int n;
-        is >> n;
-        for (int i = 0; i < n; i++) {
-            std::string name;
-            int type;
-            is >> type;
-            std::getline(is, _);
-            std::getline(is, name);
-            if (type == 1) {
-                std::string level, exp, expForNextLevel, levelPassed;
-                is >> level >> exp >> expForNextLevel >> levelPassed;
-                m_challengerList.push_back({name, level, exp, levelPassed});
-            } else if (type == 2) {
-                std::string level, madeNum, madeNumForNextLevel;
-                is >> level >> madeNum >> madeNumForNextLevel;
-                m_authorList.push_back({name, level, madeNum});
-            }
-        }
-        static const std::vector<std::string> typeList = {"闯关者", "出题者"};
-        static const std::vector<std::string> sortMethodControllerList = {"降序", "升序"};
-
-        RadioboxOption radioOption;
-        radioOption.on_change = [&] {
-            m_sortMode = 0;
-            m_sortBy = 1;
-            m_filterBy = 0;
-            m_filterText.clear();
-        };
-
-        m_typeController = Radiobox(&typeList, &m_type, radioOption);
-
-        m_sortController = Container::Vertical({Radiobox(&m_headerList, &m_sortBy),
-                                                Toggle(&sortMethodControllerList, &m_sortMode)});
-
-        m_filterController = Container::Vertical({Radiobox(&m_headerList, &m_filterBy),
-                                                  Input(&m_filterText, "输入筛选内容")});
-
-        auto controllers = Container::Vertical({m_typeController, m_sortController, m_filterController});
-        Add(Container::Vertical({controllers, m_bottomButtons}));
-    }
-
-  private:
-    Element Render() override {
-        if (m_type == 0) {
-            m_headerList = {"名称", "等级", "经验", "通过关卡数"};
-        } else {
-            m_headerList = {"名称", "等级", "出题数"};
-        }
-
-        auto table = Table(makeList());
-
-        table.SelectAll().Border(LIGHT);
-        table.SelectAll().SeparatorVertical(LIGHT);
-        table.SelectRow(0).SeparatorVertical(LIGHT);
-        table.SelectRow(0).Border(LIGHT);
-
-        return vbox({hbox({vbox({window(text("类别"), m_typeController->Render()),
-                                 window(text("排序"), m_sortController->Render()),
-                                 window(text("筛选"), m_filterController->Render())}),
-                           table.Render()}),
-                     m_bottomButtons->Render() | hcenter})
-             | hcenter
-             | size(WIDTH, EQUAL, 90)
-             | size(HEIGHT, EQUAL, 30)
-             | border;
-    }
-
-    std::vector<std::vector<std::string>> makeList() {
-        std::vector<std::vector<std::string>> list;
-        list.push_back(m_headerList);
-        auto &originalList = (m_type == 0 ? m_challengerList : m_authorList);
-        for (auto &i : originalList) {
-            if (m_filterText.empty()) {
-                list.push_back(i);
-            } else if (m_filterBy == 0 && i[m_filterBy].find(m_filterText) != std::string::npos) {
-                list.push_back(i);
-            } else if (m_filterBy != 0 && i[m_filterBy] == m_filterText) {
-                list.push_back(i);
-            }
-        }
-        std::sort(list.begin() + 1, list.end(), [&](const std::vector<std::string> &a, const std::vector<std::string> &b) {
-            bool result;
-            if (m_sortBy == 0)
-                return a[m_sortBy] > b[m_sortBy];
-            else
-                return stoi(a[m_sortBy]) > stoi(b[m_sortBy]);
-        });
-        if (m_sortMode) {
-            std::reverse(list.begin() + 1, list.end());
-        }
-        return list;
-    }
-    Component m_typeController, m_sortController, m_filterController;
-    Component m_bottomButtons;
-    int m_type = 0;
-    int m_sortMode = 0;
-    int m_sortBy = 1;
-    int m_filterBy = 0;
-    std::string m_filterText;
-    std::vector<std::string> m_headerList;
-    std::vector<std::vector<std::string>> m_challengerList, m_authorList;
-};
-
-Component RankPage(GlobalContext &ctx) {
-    return Make<RankPageBase>(ctx);
-}
+#include "GlobalContext.h"
+#include "scroller.hpp"
+#include "ui.h"
+#include <ftxui/dom/elements.hpp> // for color, Fit, LIGHT, align_right, bold, DOUBLE
+#include <ftxui/dom/table.hpp>    // for Table, TableSelection
+#include <cstdlib>
+#include <map>
+#include <set>
+
+using namespace ftxui;
+
+const int pageSize = 50;
+const int visibleRows = 20;
+// pages further than this from the view are dropped
+const int keptPages = 4;
+
+struct UserRow {
+    std::string name;
+    int level = 0;
+    // challengers
+    int exp = 0, levelPassed = 0, rating = 0;
+    // authors
+    int madeNum = 0;
+
+    std::vector<std::string> cells(int type) const {
+        if (type == 0) {
+            return {name, std::to_string(rating), std::to_string(level), std::to_string(exp), std::to_string(levelPassed)};
+        } else {
+            return {name, std::to_string(level), std::to_string(madeNum)};
+        }
+    }
+};
+
+// The server sorts and filters the list, and the page only holds the rows
+// near the ones in view, fetching more as it is scrolled.
+class RankPageBase : public PageBase {
+  public:
+    RankPageBase(GlobalContext &ctx) : PageBase(ctx) {
+        auto buttonBack = Button(
+            "返回", [&] { switchPage(MainPage(ctx)); }, ButtonOption::Ascii());
+
+        m_bottomButtons = Container::Horizontal({buttonBack});
+
+        static const std::vector<std::string> typeList = {"闯关者", "出题者"};
+        static const std::vector<std::string> sortMethodControllerList = {"降序", "升序"};
+
+        RadioboxOption radioOption;
+        radioOption.on_change = [&] {
+            m_sortMode = 0;
+            m_sortBy = 1;
+            m_filterBy = 0;
+            m_filterText.clear();
+        };
+
+        m_typeController = Radiobox(&typeList, &m_type, radioOption);
+
+        m_sortController = Container::Vertical({Radiobox(&m_headerList, &m_sortBy),
+                                                Toggle(&sortMethodControllerList, &m_sortMode)});
+
+        m_filterController = Container::Vertical({Radiobox(&m_headerList, &m_filterBy),
+                                                  Input(&m_filterText, "输入筛选内容")});
+
+        m_table = VirtualScroller([this] { return m_total; },
+                                  std::bind(&RankPageBase::renderRows, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
+                                  visibleRows);
+
+        auto controllers = Container::Vertical({m_typeController, m_sortController, m_filterController});
+        Add(Container::Vertical({Container::Horizontal({controllers, m_table}), m_bottomButtons}));
+
+        updateHeader();
+        m_nextQuery = makeQuery();
+        refresh();
+    }
+
+  private:
+    bool OnEvent(Event event) override {
+        bool handled = PageBase::OnEvent(event);
+        updateHeader();
+        std::string query = makeQuery();
+        if (query != m_nextQuery) {
+            // wait for the user to stop typing in the filter
+            m_nextQuery = query;
+            cancel(m_refreshTimer);
+            m_refreshTimer = after(std::chrono::milliseconds(200), std::bind(&RankPageBase::refresh, this));
+        }
+        return handled;
+    }
+
+    void updateHeader() {
+        if (m_type == 0) {
+            m_headerList = {"名称", "评分", "等级", "经验", "通过关卡数"};
+        } else {
+            m_headerList = {"名称", "等级", "出题数"};
+        }
+    }
+
+    // the userlist_page request without the range
+    std::string makeQuery() {
+        return "userlist_page\n"
+             + std::to_string(m_type + 1) + "\n"
+             + std::to_string(m_sortBy) + " " + std::to_string(m_sortMode) + "\n"
+             + std::to_string(m_filterBy) + "\n"
+             + m_filterText + "\n";
+    }
+
+    void refresh() {
+        m_query = m_nextQuery;
+        m_queryId++;
+        m_listType = m_type;
+        m_pages.clear();
+        m_requested.clear();
+        m_loaded = false;
+        m_total = 0;
+        fetch(0);
+    }
+
+    void fetch(int page) {
+        if (m_pages.count(page) || m_requested.count(page)) return;
+        m_requested.insert(page);
+        request(m_query + std::to_string(page * pageSize) + " " + std::to_string(pageSize) + "\n", {"userlist_page_res"},
+                [this, page, queryId = m_queryId](const std::string &type, std::istringstream &is) {
+                    if (queryId != m_queryId) return;
+                    m_requested.erase(page);
+                    readPage(page, is);
+                });
+    }
+
+    void readPage(int page, std::istringstream &is) {
+        std::string _;
+        int offset, n;
+        is >> m_total >> offset >> n;
+        std::vector<UserRow> rows;
+        rows.reserve(n);
+        for (int i = 0; i < n; i++) {
+            UserRow row;
+            int type, expForNextLevel, madeNumForNextLevel;
+            is >> type;
+            std::getline(is, _);
+            std::getline(is, row.name);
+            if (type == 1) {
+                is >> row.level >> row.exp >> expForNextLevel >> row.levelPassed >> row.rating;
+            } else if (type == 2) {
+                is >> row.level >> row.madeNum >> madeNumForNextLevel;
+            }
+            rows.push_back(std::move(row));
+        }
+        m_pages[page] = std::move(rows);
+        m_loaded = true;
+    }
+
+    Element renderRows(int begin, int end, int selected) {
+        std::vector<std::vector<std::string>> list;
+        list.push_back(m_headerList);
+        if (m_listType != m_type) {
+            // the rows are of the other type until the refresh
+            end = begin;
+        }
+        for (int i = begin; i < end; i++) {
+            auto page = m_pages.find(i / pageSize);
+            if (page != m_pages.end() && i % pageSize < (int)page->second.size()) {
+                list.push_back(page->second[i % pageSize].cells(m_listType));
+            } else {
+                fetch(i / pageSize);
+                list.push_back(std::vector<std::string>(m_headerList.size(), "..."));
+            }
+        }
+
+        // the first page is kept, asking for it again would sort anew
+        int firstPage = begin / pageSize;
+        for (auto it = m_pages.begin(); it != m_pages.end();) {
+            if (it->first != 0 && std::abs(it->first - firstPage) > keptPages) {
+                it = m_pages.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        auto table = Table(list);
+        table.SelectAll().Border(LIGHT);
+        table.SelectAll().SeparatorVertical(LIGHT);
+        table.SelectRow(0).SeparatorVertical(LIGHT);
+        table.SelectRow(0).Border(LIGHT);
+        if (selected >= begin && selected < end) {
+            table.SelectRow(selected - begin + 1).Decorate(inverted);
+        }
+
+        std::string status;
+        if (!m_loaded) {
+            status = "加载中...";
+        } else if (end > begin) {
+            status = "第 " + std::to_string(begin + 1) + "-" + std::to_string(end) + " 项，共 " + std::to_string(m_total) + " 项";
+        } else {
+            status = "没有符合条件的用户";
+        }
+        return vbox({table.Render(), text(status) | hcenter});
+    }
+
+    Element Render() override {
+        return vbox({hbox({vbox({window(text("类别"), m_typeController->Render()),
+                                 window(text("排序"), m_sortController->Render()),
+                                 window(text("筛选"), m_filterController->Render())}),
+                           m_table->Render()}),
+                     m_bottomButtons->Render() | hcenter})
+             | hcenter
+             | size(WIDTH, EQUAL, 90)
+             | size(HEIGHT, EQUAL, 30)
+             | border;
+    }
+
+    Component m_typeController, m_sortController, m_filterController;
+    Component m_table;
+    Component m_bottomButtons;
+    int m_type = 0;
+    int m_sortMode = 0;
+    int m_sortBy = 1;
+    int m_filterBy = 0;
+    std::string m_filterText;
+    std::vector<std::string> m_headerList;
+
+    // the query shown, and the one it changes to after the delay
+    std::string m_query, m_nextQuery;
+    int m_queryId = 0;
+    int m_refreshTimer = -1;
+    int m_listType = 0;
+    bool m_loaded = false;
+    int m_total = 0;
+    std::map<int, std::vector<UserRow>> m_pages;
+    std::set<int> m_requested;
+};
+
+Component RankPage(GlobalContext &ctx) {
+    return Make<RankPageBase>(ctx);
+}
@@ -0,0 +1,100 @@
+#include "Scheduler.h"
+#include <algorithm>
+
+Scheduler::Scheduler(Post post, Clock::duration framePeriod)
+    : m_post(post), m_framePeriod(framePeriod) {
+    m_thread = std::thread(&Scheduler::run, this);
+}
+
+Scheduler::~Scheduler() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_changed.notify_one();
+    m_thread.join();
+}
+
+int Scheduler::every(const void *owner, Clock::duration interval, std::function<void()> f) {
+    return add(owner, interval, interval, f);
+}
+
+int Scheduler::after(const void *owner, Clock::duration delay, std::function<void()> f) {
+    return add(owner, delay, Clock::duration::zero(), f);
+}
+
+int Scheduler::add(const void *owner, Clock::duration delay, Clock::duration interval, std::function<void()> f) {
+    int id;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        id = m_nextId++;
+        m_timers[id] = {owner, Clock::now() + delay, interval, f};
+    }
+    m_changed.notify_one();
+    return id;
+}
+
+void Scheduler::cancel(int id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_timers.erase(id);
+}
+
+void Scheduler::cancelAll(const void *owner) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_timers.begin(); it != m_timers.end();) {
+        if (it->second.owner == owner) {
+            it = m_timers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void Scheduler::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stop) {
+        auto next = Clock::time_point::max();
+        for (const auto &[id, timer] : m_timers) {
+            if (!timer.fired) next = std::min(next, timer.deadline);
+        }
+        if (next == Clock::time_point::max()) {
+            m_changed.wait(lock);
+            continue;
+        }
+        // wake on the frame boundary at or after the deadline
+        auto frames = (next - m_start + m_framePeriod - Clock::duration(1)) / m_framePeriod;
+        if (m_changed.wait_until(lock, m_start + frames * m_framePeriod) == std::cv_status::no_timeout) {
+            continue;
+        }
+
+        auto now = Clock::now();
+        std::vector<int> due;
+        for (auto &[id, timer] : m_timers) {
+            if (timer.fired || timer.deadline > now) continue;
+            due.push_back(id);
+            if (timer.interval == Clock::duration::zero()) {
+                timer.fired = true;
+            } else {
+                // a repeating timer that fell behind skips the missed runs
+                while (timer.deadline <= now) timer.deadline += timer.interval;
+            }
+        }
+        if (!due.empty()) {
+            m_post([this, due] { runDue(due); });
+        }
+    }
+}
+
+void Scheduler::runDue(const std::vector<int> &ids) {
+    for (int id : ids) {
+        std::function<void()> f;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_timers.find(id);
+            if (it == m_timers.end()) continue;
+            f = it->second.f;
+            if (it->second.fired) m_timers.erase(it);
+        }
+        f();
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Timers for the whole client on one thread. Timers due in the same frame
+// are run together in one task posted to the UI thread, so the screen is
+// redrawn at most once per frame, and the thread sleeps while no timer is
+// registered. Timers belong to an owner, normally a page, and are removed
+// together with it.
+class Scheduler {
+  public:
+    using Post = std::function<void(std::function<void()>)>;
+    using Clock = std::chrono::steady_clock;
+
+    explicit Scheduler(Post post, Clock::duration framePeriod = std::chrono::milliseconds(50));
+    ~Scheduler();
+
+    Scheduler(const Scheduler &) = delete;
+    Scheduler &operator=(const Scheduler &) = delete;
+
+    // calls f on the UI thread every interval until cancelled
+    int every(const void *owner, Clock::duration interval, std::function<void()> f);
+    // calls f on the UI thread once, after delay
+    int after(const void *owner, Clock::duration delay, std::function<void()> f);
+
+    // only call these on the UI thread; a cancelled timer never runs again
+    void cancel(int id);
+    void cancelAll(const void *owner);
+
+  private:
+    struct Timer {
+        const void *owner;
+        Clock::time_point deadline;
+        Clock::duration interval; // zero for one-shot timers
+        std::function<void()> f;
+        bool fired = false;
+    };
+
+    int add(const void *owner, Clock::duration delay, Clock::duration interval, std::function<void()> f);
+    void run();
+    void runDue(const std::vector<int> &ids);
+
+    Post m_post;
+    Clock::duration m_framePeriod;
+    Clock::time_point m_start = Clock::now();
+
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::map<int, Timer> m_timers;
+    int m_nextId = 0;
+    bool m_stop = false;
+    std::thread m_thread;
+};
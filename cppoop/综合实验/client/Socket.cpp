@@ -1,54 +1,337 @@
-#include "Socket.h"
-#include <iostream>
-
-using asio::ip::tcp;
-
-Socket::~Socket() {
-    disconnect();
-}
-
-bool Socket::connect(std::string servername) {
-    tcp::resolver resolver(m_ioContext);
-    size_t pos = servername.find(':');
-    std::string host = servername.substr(0, pos);
-    std::string port = servername.substr(pos + 1);
-    try {
-        asio::connect(m_socket, resolver.resolve(host, port));
-        return true;
-    } catch (std::exception &e) {
-        std::cerr << "Exception: " << e.what() << "\n";
-        m_socket.close();
-        return false;
-    }
-}
-
-void Socket::disconnect() {
-    m_socket.close();
-}
-
-void Socket::write(std::string s) {
-    try {
-        asio::write(m_socket, asio::buffer(s.c_str(), s.length() + 1));
-    } catch (std::exception &e) {
-        std::cerr << "Exception: " << e.what() << "\n";
-        m_socket.close();
-    }
-}
-
-std::string Socket::read() {
-    try {
-        size_t len = asio::read_until(m_socket, m_inbuf, '\0');
-        std::istream is(&m_inbuf);
-        std::string s;
-        std::getline(is, s, '\0');
-        return s;
-    } catch (std::exception &e) {
-        std::cerr << "Exception: " << e.what() << "\n";
-        m_socket.close();
-        return "";
-    }
-}
-
-std::istringstream Socket::readStream() {
-    return std::istringstream(read());
-}
+#include "Socket.h"
+#include <algorithm>
+#include <chrono>
+
+using asio::ip::tcp;
+
+const size_t sentLogSize = 16;
+const size_t unclaimedSize = 16;
+
+Socket::Socket() : m_post([](std::function<void()> f) { f(); }) {
+    m_thread = std::thread([this] { m_ioContext.run(); });
+}
+
+Socket::~Socket() {
+    // run() returns once the aborted handlers of the stream have run out
+    asio::post(m_ioContext, [this] { closeStream(); });
+    m_work.reset();
+    m_thread.join();
+}
+
+void Socket::setPost(Post post) {
+    m_post = post;
+}
+
+void Socket::setOnDisconnect(std::function<void()> onDisconnect) {
+    m_onDisconnect = onDisconnect;
+}
+
+void Socket::connect(std::string servername, std::function<void(bool)> callback) {
+    asio::post(m_ioContext, [this, servername, callback] {
+        m_servername = servername;
+        m_resumeToken.clear();
+        m_sent = m_received = 0;
+        m_sentLog.clear();
+        m_pending.clear();
+        m_listeners.clear();
+        m_unclaimed.clear();
+        bool ok = open();
+        if (ok) {
+            async_read();
+#ifdef USE_ZLIB
+            enqueue("set_compression\n1\n");
+#endif
+        }
+        m_post([callback, ok] { callback(ok); });
+    });
+}
+
+void Socket::setResumeToken(const std::string &token) {
+    asio::post(m_ioContext, [this, token] { m_resumeToken = token; });
+}
+
+// opens a new connection to m_servername; sync, on the io thread
+bool Socket::open() {
+    closeStream();
+    m_writing = false;
+    m_writeQueue.clear();
+    m_inbuf.consume(m_inbuf.size());
+
+    std::string servername = m_servername;
+    tcp::resolver resolver(m_ioContext);
+    bool tls = servername.rfind("tls://", 0) == 0;
+    if (tls) servername = servername.substr(6);
+    size_t pos = servername.find(':');
+    std::string host = servername.substr(0, pos);
+    std::string port = servername.substr(pos + 1);
+    try {
+        if (tls) {
+#ifdef USE_TLS
+            if (!m_tlsContextReady) {
+                m_tlsContext.set_default_verify_paths();
+                m_tlsContextReady = true;
+            }
+            m_stream = std::make_shared<TlsStream>(tcp::socket(m_ioContext), m_tlsContext, &m_tlsSession);
+#else
+            return false;
+#endif
+        } else {
+            m_stream = std::make_shared<TcpStream>(tcp::socket(m_ioContext));
+        }
+        m_stream->connect(resolver.resolve(host, port), host);
+#ifdef USE_ZLIB
+        m_decompressor = MessageDecompressor();
+#endif
+        return true;
+    } catch (std::exception &) {
+        closeStream();
+        return false;
+    }
+}
+
+// The handlers of the stream's operations, which are aborted, are left to
+// run and do nothing; they hold the stream until then.
+void Socket::closeStream() {
+    m_generation++;
+    if (m_stream) {
+        m_stream->close();
+        m_stream.reset();
+    }
+}
+
+// Reattaches to the parked server-side session, retrying for a few
+// seconds. The session is gone if this returns false.
+bool Socket::reconnect() {
+    if (m_resumeToken.empty()) return false;
+    for (int attempt = 0; attempt < 5; attempt++) {
+        if (attempt > 0) std::this_thread::sleep_for(std::chrono::seconds(1));
+        if (!open()) continue;
+        try {
+            std::string s = "resume\n" + m_resumeToken + "\n" + std::to_string(m_received) + "\n";
+            m_stream->write(asio::buffer(s.c_str(), s.length() + 1));
+            m_stream->read_until(m_inbuf, '\0');
+            std::istringstream is(readMessage());
+            std::string type, result;
+            unsigned long long serverReceived = 0;
+            std::getline(is, type);
+            std::getline(is, result);
+            is >> serverReceived;
+            if (result != "success" || serverReceived > m_sent || m_sent - serverReceived > m_sentLog.size()) {
+                return false;
+            }
+            m_writeQueue.assign(m_sentLog.end() - (m_sent - serverReceived), m_sentLog.end());
+            async_read();
+            if (!m_writeQueue.empty()) {
+                write_next();
+            }
+#ifdef USE_ZLIB
+            enqueue("set_compression\n1\n");
+#endif
+            return true;
+        } catch (std::exception &) {
+        }
+    }
+    return false;
+}
+
+// the connection failed; resume the session or give up on it
+void Socket::lost() {
+    if (reconnect()) return;
+    m_resumeToken.clear();
+    m_pending.clear();
+    m_listeners.clear();
+    m_unclaimed.clear();
+    closeStream();
+    if (m_onDisconnect) {
+        m_post(m_onDisconnect);
+    }
+}
+
+#ifdef USE_TLS
+void Socket::setTlsCaFile(const std::string &path) {
+    m_tlsContext.set_default_verify_paths();
+    m_tlsContext.load_verify_file(path);
+    m_tlsContextReady = true;
+}
+#endif
+
+void Socket::disconnect() {
+    asio::post(m_ioContext, [this] {
+        m_resumeToken.clear();
+        m_pending.clear();
+        m_listeners.clear();
+        m_unclaimed.clear();
+        closeStream();
+    });
+}
+
+void Socket::send(const std::string &msg) {
+    asio::post(m_ioContext, [this, msg] { enqueue(msg); });
+}
+
+void Socket::request(const std::string &msg, std::vector<std::string> types, Handler handler) {
+    asio::post(m_ioContext, [this, msg, types, handler] {
+        // whatever arrived unclaimed belongs to an earlier exchange
+        m_unclaimed.clear();
+        m_pending.push_back({types, handler});
+        enqueue(msg);
+    });
+}
+
+void Socket::expect(std::vector<std::string> types, Handler handler) {
+    asio::post(m_ioContext, [this, types, handler] {
+        for (auto it = m_unclaimed.begin(); it != m_unclaimed.end(); ++it) {
+            std::string type = it->substr(0, it->find('\n'));
+            if (std::find(types.begin(), types.end(), type) != types.end()) {
+                std::string msg = *it;
+                m_unclaimed.erase(it);
+                deliver(handler, msg);
+                return;
+            }
+        }
+        m_pending.push_back({types, handler});
+    });
+}
+
+void Socket::listen(std::vector<std::string> types, Handler handler) {
+    asio::post(m_ioContext, [this, types, handler] {
+        for (auto &type : types) {
+            if (handler) {
+                m_listeners[type] = handler;
+            } else {
+                m_listeners.erase(type);
+            }
+        }
+    });
+}
+
+void Socket::enqueue(const std::string &msg) {
+    if (!m_stream) return;
+    m_sent++;
+    m_sentLog.push_back(msg);
+    if (m_sentLog.size() > sentLogSize) {
+        m_sentLog.pop_front();
+    }
+    m_writeQueue.push_back(msg);
+    if (!m_writing) {
+        write_next();
+    }
+}
+
+void Socket::write_next() {
+    int generation = m_generation;
+    // the queue is cleared when the stream closes, before the write is
+    // aborted; the message is kept as long as the stream
+    auto s = std::make_shared<std::string>(m_writeQueue.front());
+    m_writing = true;
+    m_stream->async_write(asio::buffer(s->c_str(), s->length() + 1),
+                          [this, generation, s, stream = m_stream](std::error_code ec, std::size_t length) {
+                              if (generation != m_generation) return;
+                              m_writing = false;
+                              if (ec) {
+                                  lost();
+                                  return;
+                              }
+                              m_writeQueue.pop_front();
+                              if (!m_writeQueue.empty()) {
+                                  write_next();
+                              }
+                          });
+}
+
+void Socket::async_read() {
+    int generation = m_generation;
+    m_stream->async_read_until(m_inbuf, '\0', [this, generation, stream = m_stream](std::error_code ec,
+                                                                                      std::size_t length) {
+        if (generation != m_generation) return;
+        if (ec) {
+            lost();
+            return;
+        }
+#ifdef USE_ZLIB
+        if (*asio::buffers_begin(m_inbuf.data()) == compressedFrameMarker) {
+            std::string header(asio::buffers_begin(m_inbuf.data()),
+                               asio::buffers_begin(m_inbuf.data()) + compressedFrameHeaderSize);
+            size_t frameSize = MessageDecompressor::frameSize(header.c_str());
+            // the payload may hold '\0' bytes, so read_until may have stopped early
+            if (m_inbuf.size() < frameSize + 1) {
+                m_stream->async_read_exactly(m_inbuf, frameSize + 1 - m_inbuf.size(),
+                                             [this, generation, stream](std::error_code ec, std::size_t length) {
+                                                 if (generation != m_generation) return;
+                                                 if (ec) {
+                                                     lost();
+                                                     return;
+                                                 }
+                                                 received();
+                                             });
+                return;
+            }
+        }
+#endif
+        received();
+    });
+}
+
+// a whole message is in m_inbuf
+void Socket::received() {
+    std::string msg;
+    try {
+        msg = readMessage();
+    } catch (std::exception &) {
+        // a corrupt compressed frame; start over on a new connection
+        lost();
+        return;
+    }
+    dispatch(msg);
+    async_read();
+}
+
+// takes the complete message at the front of m_inbuf
+std::string Socket::readMessage() {
+#ifdef USE_ZLIB
+    if (*asio::buffers_begin(m_inbuf.data()) == compressedFrameMarker) {
+        std::string header(asio::buffers_begin(m_inbuf.data()),
+                           asio::buffers_begin(m_inbuf.data()) + compressedFrameHeaderSize);
+        size_t frameSize = MessageDecompressor::frameSize(header.c_str());
+        std::string frame(asio::buffers_begin(m_inbuf.data()),
+                          asio::buffers_begin(m_inbuf.data()) + frameSize);
+        m_inbuf.consume(frameSize + 1);
+        return m_decompressor.decompress(frame);
+    }
+#endif
+    std::istream is(&m_inbuf);
+    std::string s;
+    std::getline(is, s, '\0');
+    return s;
+}
+
+void Socket::dispatch(const std::string &msg) {
+    m_received++;
+    std::string type = msg.substr(0, msg.find('\n'));
+    auto listener = m_listeners.find(type);
+    if (listener != m_listeners.end()) {
+        deliver(listener->second, msg);
+        return;
+    }
+    for (auto it = m_pending.begin(); it != m_pending.end(); ++it) {
+        if (std::find(it->types.begin(), it->types.end(), type) != it->types.end()) {
+            Handler handler = it->handler;
+            m_pending.erase(it);
+            deliver(handler, msg);
+            return;
+        }
+    }
+    m_unclaimed.push_back(msg);
+    if (m_unclaimed.size() > unclaimedSize) {
+        m_unclaimed.pop_front();
+    }
+}
+
+void Socket::deliver(Handler handler, const std::string &msg) {
+    m_post([handler, msg] {
+        std::istringstream is(msg);
+        std::string type;
+        std::getline(is, type);
+        handler(type, is);
+    });
+}
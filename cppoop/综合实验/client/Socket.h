@@ -1,24 +1,116 @@
-#pragma once
-
-#include "asio.hpp"
-#include <iostream>
-
-class Socket {
-  public:
-    ~Socket();
-
-    bool connect(std::string servername);
-
-    void disconnect();
-
-    void write(std::string s);
-
-    std::string read();
-
-    std::istringstream readStream();
-
-  private:
-    asio::io_context m_ioContext;
-    asio::ip::tcp::socket m_socket{m_ioContext};
-    asio::streambuf m_inbuf;
-};
\ No newline at end of file
+#pragma once
+
+#include "Stream.h"
+#include "asio.hpp"
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+#ifdef USE_ZLIB
+#include "Compression.h"
+#endif
+
+// Connection to the server, driven by a background io thread so the UI
+// never waits on the network. Replies are matched to requests by their
+// type line, and handlers run wherever the Post function puts them, which
+// for the UI is the screen's event loop.
+class Socket {
+  public:
+    using Post = std::function<void(std::function<void()>)>;
+    // gets the reply's type line and an istream positioned after it
+    using Handler = std::function<void(const std::string &type, std::istringstream &is)>;
+
+    Socket();
+    ~Socket();
+
+    // handlers and callbacks are run inline on the io thread until this is set
+    void setPost(Post post);
+
+    // called when the connection is lost and could not be resumed
+    void setOnDisconnect(std::function<void()> onDisconnect);
+
+    // servername is host:port, or tls://host:port for a TLS connection
+    void connect(std::string servername, std::function<void(bool)> callback);
+
+    // After login, a dropped connection is reopened and reattached to the
+    // server-side session with this token, transparently to the caller.
+    void setResumeToken(const std::string &token);
+
+    void disconnect();
+
+    // sends msg without expecting a reply
+    void send(const std::string &msg);
+
+    // sends msg and calls handler with the first reply of one of the types
+    void request(const std::string &msg, std::vector<std::string> types, Handler handler);
+
+    // calls handler with the next message of one of the types, including
+    // one that arrived unclaimed since the last request
+    void expect(std::vector<std::string> types, Handler handler);
+
+    // calls handler with every message of one of the types, ahead of
+    // requests and expects, until replaced or removed with a null handler
+    void listen(std::vector<std::string> types, Handler handler);
+
+#ifdef USE_TLS
+    // trust this CA file in addition to the system's
+    void setTlsCaFile(const std::string &path);
+#endif
+
+  private:
+    struct Pending {
+        std::vector<std::string> types;
+        Handler handler;
+    };
+
+    bool open();
+    void closeStream();
+    bool reconnect();
+    void lost();
+    void enqueue(const std::string &msg);
+    void write_next();
+    void async_read();
+    void received();
+    void dispatch(const std::string &msg);
+    void deliver(Handler handler, const std::string &msg);
+    std::string readMessage();
+
+    asio::io_context m_ioContext;
+    asio::executor_work_guard<asio::io_context::executor_type> m_work{m_ioContext.get_executor()};
+    Post m_post;
+    std::function<void()> m_onDisconnect;
+
+    // everything below is only touched on the io thread
+    std::string m_servername;
+    std::string m_resumeToken;
+    // messages sent and received in this session, excluding the resume
+    // handshake; the server resends what we missed and we what it missed
+    unsigned long long m_sent = 0, m_received = 0;
+    std::deque<std::string> m_sentLog;
+    std::deque<std::string> m_writeQueue;
+    bool m_writing = false;
+    // handlers of a closed stream are ignored
+    int m_generation = 0;
+    std::deque<Pending> m_pending;
+    std::map<std::string, Handler> m_listeners;
+    std::deque<std::string> m_unclaimed;
+
+    // Each handler holds the stream it was started on: a closed stream's
+    // aborted operations still use it until their handlers have run.
+    std::shared_ptr<Stream> m_stream;
+    asio::streambuf m_inbuf;
+#ifdef USE_TLS
+    asio::ssl::context m_tlsContext{asio::ssl::context::tls_client};
+    bool m_tlsContextReady = false;
+    TlsSession m_tlsSession;
+#endif
+#ifdef USE_ZLIB
+    MessageDecompressor m_decompressor;
+#endif
+
+    std::thread m_thread;
+};
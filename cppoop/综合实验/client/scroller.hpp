@@ -1,81 +1,149 @@
-#pragma once
-
-#include <algorithm>                           // for max, min
-#include <ftxui/component/component_base.hpp>  // for Component, ComponentBase
-#include <ftxui/component/event.hpp>  // for Event, Event::ArrowDown, Event::ArrowUp, Event::End, Event::Home, Event::PageDown, Event::PageUp
-#include <memory>   // for shared_ptr, allocator, __shared_ptr_access
-#include <utility>  // for move
-
-#include "ftxui/component/component.hpp"  // for Make
-#include "ftxui/component/mouse.hpp"  // for Mouse, Mouse::WheelDown, Mouse::WheelUp
-#include "ftxui/dom/deprecated.hpp"  // for text
-#include "ftxui/dom/elements.hpp"  // for operator|, Element, size, vbox, EQUAL, HEIGHT, dbox, reflect, focus, inverted, nothing, select, vscroll_indicator, yflex, yframe
-#include "ftxui/dom/node.hpp"      // for Node
-#include "ftxui/dom/requirement.hpp"  // for Requirement
-#include "ftxui/screen/box.hpp"       // for Box
-
-namespace ftxui {
-
-class ScrollerBase : public ComponentBase {
- public:
-  ScrollerBase(Component child) { Add(child); }
-
- private:
-  Element Render() final {
-    auto focused = Focused() ? focus : ftxui::select;
-    auto style = Focused() ? inverted : nothing;
-
-    Element background = ComponentBase::Render();
-    background->ComputeRequirement();
-    size_ = background->requirement().min_y;
-    return dbox({
-               std::move(background),
-               vbox({
-                   text(L"") | size(HEIGHT, EQUAL, selected_),
-                   text(L"") | style | focused,
-               }),
-           }) |
-           vscroll_indicator | yframe | yflex | reflect(box_);
-  }
-
-  bool OnEvent(Event event) final {
-    if (event.is_mouse() && box_.Contain(event.mouse().x, event.mouse().y))
-      TakeFocus();
-
-    int selected_old = selected_;
-    if (event == Event::ArrowUp || event == Event::Character('k') ||
-        (event.is_mouse() && event.mouse().button == Mouse::WheelUp)) {
-      selected_--;
-    }
-    if ((event == Event::ArrowDown || event == Event::Character('j') ||
-         (event.is_mouse() && event.mouse().button == Mouse::WheelDown))) {
-      selected_++;
-    }
-    if (event == Event::PageDown)
-      selected_ += box_.y_max - box_.y_min;
-    if (event == Event::PageUp)
-      selected_ -= box_.y_max - box_.y_min;
-    if (event == Event::Home)
-      selected_ = 0;
-    if (event == Event::End)
-      selected_ = size_;
-
-    selected_ = std::max(0, std::min(size_ - 1, selected_));
-    return selected_old != selected_;
-  }
-
-  bool Focusable() const final { return true; }
-
-  int selected_ = 0;
-  int size_ = 0;
-  Box box_;
-};
-
-inline Component Scroller(Component child) {
-  return Make<ScrollerBase>(std::move(child));
-}
-}  // namespace ftxui
-
-// Copyright 2021 Arthur Sonzogni. All rights reserved.
-// Use of this source code is governed by the MIT license that can be found in
+#pragma once
+
+#include <algorithm>                           // for max, min
+#include <functional>                          // for function
+#include <ftxui/component/component_base.hpp>  // for Component, ComponentBase
+#include <ftxui/component/event.hpp>  // for Event, Event::ArrowDown, Event::ArrowUp, Event::End, Event::Home, Event::PageDown, Event::PageUp
+#include <memory>   // for shared_ptr, allocator, __shared_ptr_access
+#include <utility>  // for move
+
+#include "ftxui/component/component.hpp"  // for Make
+#include "ftxui/component/mouse.hpp"  // for Mouse, Mouse::WheelDown, Mouse::WheelUp
+#include "ftxui/dom/deprecated.hpp"  // for text
+#include "ftxui/dom/elements.hpp"  // for operator|, Element, size, vbox, EQUAL, HEIGHT, dbox, reflect, focus, inverted, nothing, select, vscroll_indicator, yflex, yframe
+#include "ftxui/dom/node.hpp"      // for Node
+#include "ftxui/dom/requirement.hpp"  // for Requirement
+#include "ftxui/screen/box.hpp"       // for Box
+
+namespace ftxui {
+
+class ScrollerBase : public ComponentBase {
+ public:
+  ScrollerBase(Component child) { Add(child); }
+
+ private:
+  Element Render() final {
+    auto focused = Focused() ? focus : ftxui::select;
+    auto style = Focused() ? inverted : nothing;
+
+    Element background = ComponentBase::Render();
+    background->ComputeRequirement();
+    size_ = background->requirement().min_y;
+    return dbox({
+               std::move(background),
+               vbox({
+                   text(L"") | size(HEIGHT, EQUAL, selected_),
+                   text(L"") | style | focused,
+               }),
+           }) |
+           vscroll_indicator | yframe | yflex | reflect(box_);
+  }
+
+  bool OnEvent(Event event) final {
+    if (event.is_mouse() && box_.Contain(event.mouse().x, event.mouse().y))
+      TakeFocus();
+
+    int selected_old = selected_;
+    if (event == Event::ArrowUp || event == Event::Character('k') ||
+        (event.is_mouse() && event.mouse().button == Mouse::WheelUp)) {
+      selected_--;
+    }
+    if ((event == Event::ArrowDown || event == Event::Character('j') ||
+         (event.is_mouse() && event.mouse().button == Mouse::WheelDown))) {
+      selected_++;
+    }
+    if (event == Event::PageDown)
+      selected_ += box_.y_max - box_.y_min;
+    if (event == Event::PageUp)
+      selected_ -= box_.y_max - box_.y_min;
+    if (event == Event::Home)
+      selected_ = 0;
+    if (event == Event::End)
+      selected_ = size_;
+
+    selected_ = std::max(0, std::min(size_ - 1, selected_));
+    return selected_old != selected_;
+  }
+
+  bool Focusable() const final { return true; }
+
+  int selected_ = 0;
+  int size_ = 0;
+  Box box_;
+};
+
+inline Component Scroller(Component child) {
+  return Make<ScrollerBase>(std::move(child));
+}
+
+// Scroller for long lists: only the rows in view are rendered, so the cost
+// of a frame does not depend on size(). render(begin, end, selected) draws
+// rows [begin, end); selected is -1 when the scroller is not focused.
+class VirtualScrollerBase : public ComponentBase {
+ public:
+  VirtualScrollerBase(std::function<int()> size,
+                      std::function<Element(int, int, int)> render,
+                      int height)
+      : size_(std::move(size)), render_(std::move(render)), height_(height) {}
+
+ private:
+  Element Render() final {
+    int size = size_();
+    Clamp(size);
+    // move the window as little as needed to keep the selection in view
+    first_ = std::min(first_, selected_);
+    first_ = std::max(first_, selected_ - height_ + 1);
+    first_ = std::max(0, std::min(first_, size - height_));
+    return render_(first_, std::min(size, first_ + height_),
+                   Focused() ? selected_ : -1) |
+           reflect(box_);
+  }
+
+  bool OnEvent(Event event) final {
+    if (event.is_mouse() && box_.Contain(event.mouse().x, event.mouse().y))
+      TakeFocus();
+
+    int selected_old = selected_;
+    if (event == Event::ArrowUp || event == Event::Character('k') ||
+        (event.is_mouse() && event.mouse().button == Mouse::WheelUp)) {
+      selected_--;
+    }
+    if ((event == Event::ArrowDown || event == Event::Character('j') ||
+         (event.is_mouse() && event.mouse().button == Mouse::WheelDown))) {
+      selected_++;
+    }
+    if (event == Event::PageDown)
+      selected_ += height_;
+    if (event == Event::PageUp)
+      selected_ -= height_;
+    if (event == Event::Home)
+      selected_ = 0;
+    if (event == Event::End)
+      selected_ = size_() - 1;
+
+    Clamp(size_());
+    return selected_old != selected_;
+  }
+
+  void Clamp(int size) { selected_ = std::max(0, std::min(size - 1, selected_)); }
+
+  bool Focusable() const final { return true; }
+
+  std::function<int()> size_;
+  std::function<Element(int, int, int)> render_;
+  int height_;
+  int selected_ = 0;
+  int first_ = 0;
+  Box box_;
+};
+
+inline Component VirtualScroller(std::function<int()> size,
+                                 std::function<Element(int, int, int)> render,
+                                 int height) {
+  return Make<VirtualScrollerBase>(std::move(size), std::move(render), height);
+}
+}  // namespace ftxui
+
+// Copyright 2021 Arthur Sonzogni. All rights reserved.
+// Use of this source code is governed by the MIT license that can be found in
 // the LICENSE file.
\ No newline at end of file
@@ -1,30 +1,73 @@
-#pragma once
-#include "GlobalContext.h"
-#include "ftxui/component/component.hpp"
-#include "ftxui/component/component_base.hpp"
-
-class PageBase : public ftxui::ComponentBase {
-  public:
-    PageBase(GlobalContext &ctx) : m_ctx(ctx) {}
-
-  protected:
-    GlobalContext &m_ctx;
-    Socket &m_socket = m_ctx.socket;
-
-    void switchPage(ftxui::Component page) {
-        m_ctx.router->switchPage(page);
-    }
-
-    void alert(const std::string &msg) {
-        m_ctx.router->alert(msg);
-    }
-};
-
-ftxui::Component ConnectPage(GlobalContext &ctx);
-ftxui::Component LoginPage(GlobalContext &ctx);
-ftxui::Component SignupPage(GlobalContext &ctx);
-ftxui::Component MainPage(GlobalContext &ctx);
-ftxui::Component PlayPage(GlobalContext &ctx);
-ftxui::Component MakePage(GlobalContext &ctx);
-ftxui::Component RankPage(GlobalContext &ctx);
-ftxui::Component BattlePage(GlobalContext &ctx);
+#pragma once
+#include "GlobalContext.h"
+#include "ftxui/component/component.hpp"
+#include "ftxui/component/component_base.hpp"
+
+class PageBase : public ftxui::ComponentBase {
+  public:
+    PageBase(GlobalContext &ctx) : m_ctx(ctx) {}
+    ~PageBase() {
+        *m_shown = false;
+        m_ctx.scheduler.cancelAll(this);
+    }
+
+  protected:
+    GlobalContext &m_ctx;
+    Socket &m_socket = m_ctx.socket;
+
+    void switchPage(ftxui::Component page) {
+        *m_shown = false;
+        m_ctx.scheduler.cancelAll(this);
+        m_ctx.router->switchPage(page);
+    }
+
+    // Replies arrive after the page may have been left; their handlers
+    // only run while it is shown.
+    template <class F>
+    auto whileShown(F f) {
+        return [shown = m_shown, f](auto &&...args) {
+            if (*shown) f(args...);
+        };
+    }
+
+    void request(const std::string &msg, std::vector<std::string> types, Socket::Handler handler) {
+        m_socket.request(msg, types, whileShown(handler));
+    }
+
+    void expect(std::vector<std::string> types, Socket::Handler handler) {
+        m_socket.expect(types, whileShown(handler));
+    }
+
+    void listen(std::vector<std::string> types, Socket::Handler handler) {
+        m_socket.listen(types, whileShown(handler));
+    }
+
+    // timers of the page stop when it is left
+    int every(std::chrono::milliseconds interval, std::function<void()> f) {
+        return m_ctx.scheduler.every(this, interval, whileShown(f));
+    }
+
+    int after(std::chrono::milliseconds delay, std::function<void()> f) {
+        return m_ctx.scheduler.after(this, delay, whileShown(f));
+    }
+
+    void cancel(int timer) {
+        m_ctx.scheduler.cancel(timer);
+    }
+
+    void alert(const std::string &msg) {
+        m_ctx.router->alert(msg);
+    }
+
+  private:
+    std::shared_ptr<bool> m_shown = std::make_shared<bool>(true);
+};
+
+ftxui::Component ConnectPage(GlobalContext &ctx);
+ftxui::Component LoginPage(GlobalContext &ctx);
+ftxui::Component SignupPage(GlobalContext &ctx);
+ftxui::Component MainPage(GlobalContext &ctx);
+ftxui::Component PlayPage(GlobalContext &ctx);
+ftxui::Component MakePage(GlobalContext &ctx);
+ftxui::Component RankPage(GlobalContext &ctx);
+ftxui::Component BattlePage(GlobalContext &ctx);
@@ -0,0 +1,87 @@
+#pragma once
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <zlib.h>
+
+// Compressed frames replace a message on the wire as
+//   0x01 (payload length, 8 hex digits) (raw deflate payload) '\0'
+// The payload may contain '\0', so a reader that finds the marker reads the
+// length and then the exact number of bytes.
+//
+// Each message is deflated with the previous one as preset dictionary.
+// Consecutive userlist_res replies are mostly identical, so after the first
+// one little more than the changes is sent. Both ends keep their dictionary
+// per connection and must see the same messages in the same order.
+
+const char compressedFrameMarker = '\x01';
+const size_t compressedFrameHeaderSize = 9;
+
+class MessageCompressor {
+  public:
+    std::string compress(const std::string &msg) {
+        z_stream zs{};
+        deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+        setDictionary(zs, m_dictionary, deflateSetDictionary);
+        std::string payload(deflateBound(&zs, msg.size()), '\0');
+        zs.next_in = (Bytef *)msg.data();
+        zs.avail_in = (uInt)msg.size();
+        zs.next_out = (Bytef *)payload.data();
+        zs.avail_out = (uInt)payload.size();
+        deflate(&zs, Z_FINISH);
+        payload.resize(zs.total_out);
+        deflateEnd(&zs);
+        m_dictionary = msg;
+
+        char header[compressedFrameHeaderSize + 1];
+        std::snprintf(header, sizeof(header), "%c%08zx", compressedFrameMarker, payload.size());
+        return header + payload;
+    }
+
+  private:
+    std::string m_dictionary;
+
+    template <class F>
+    static void setDictionary(z_stream &zs, const std::string &dictionary, F f) {
+        // deflate only looks back 32 KiB
+        size_t size = std::min<size_t>(dictionary.size(), 32768);
+        if (size) f(&zs, (const Bytef *)dictionary.data() + dictionary.size() - size, (uInt)size);
+    }
+
+    friend class MessageDecompressor;
+};
+
+class MessageDecompressor {
+  public:
+    // total bytes of the frame starting with header, excluding the '\0'
+    static size_t frameSize(const char *header) {
+        return compressedFrameHeaderSize + std::stoul(std::string(header + 1, 8), nullptr, 16);
+    }
+
+    std::string decompress(const std::string &frame) {
+        z_stream zs{};
+        inflateInit2(&zs, -15);
+        MessageCompressor::setDictionary(zs, m_dictionary, inflateSetDictionary);
+        zs.next_in = (Bytef *)frame.data() + compressedFrameHeaderSize;
+        zs.avail_in = (uInt)(frame.size() - compressedFrameHeaderSize);
+        std::string msg;
+        char buf[16384];
+        int ret;
+        do {
+            zs.next_out = (Bytef *)buf;
+            zs.avail_out = sizeof(buf);
+            ret = inflate(&zs, Z_NO_FLUSH);
+            msg.append(buf, sizeof(buf) - zs.avail_out);
+        } while (ret == Z_OK);
+        inflateEnd(&zs);
+        if (ret != Z_STREAM_END) {
+            throw std::runtime_error("bad compressed frame");
+        }
+        m_dictionary = msg;
+        return msg;
+    }
+
+  private:
+    std::string m_dictionary;
+};
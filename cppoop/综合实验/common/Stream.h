@@ -0,0 +1,162 @@
+#pragma once
+#include "asio.hpp"
+#include <functional>
+#include <memory>
+#include <string>
+#ifdef USE_TLS
+#include "asio/ssl.hpp"
+#endif
+
+// The connection under Session and Socket: plain TCP, or TLS over TCP when
+// built with USE_TLS. Sync operations throw std::system_error like asio
+// does; the client only uses them to set up a connection.
+//
+// Both ends turn off Nagle's algorithm. Messages are small and often sent
+// back to back, and the second would otherwise wait for the peer's delayed
+// ACK of the first, about 40 ms.
+class Stream {
+  public:
+    using Handler = std::function<void(std::error_code, std::size_t)>;
+
+    virtual ~Stream() = default;
+
+    virtual void async_handshake(std::function<void(std::error_code)> handler) = 0;
+    virtual void async_read_until(asio::streambuf &buf, char delim, Handler handler) = 0;
+    virtual void async_read_exactly(asio::streambuf &buf, std::size_t n, Handler handler) = 0;
+    virtual void async_write(asio::const_buffer buffer, Handler handler) = 0;
+
+    // connects and, for TLS, verifies host and does the handshake
+    virtual void connect(const asio::ip::tcp::resolver::results_type &endpoints, const std::string &host) = 0;
+    virtual std::size_t read_until(asio::streambuf &buf, char delim) = 0;
+    virtual std::size_t read_exactly(asio::streambuf &buf, std::size_t n) = 0;
+    virtual void write(asio::const_buffer buffer) = 0;
+
+    virtual void close() = 0;
+};
+
+class TcpStream : public Stream {
+  public:
+    explicit TcpStream(asio::ip::tcp::socket &&socket) : m_socket(std::move(socket)) {}
+
+    void async_handshake(std::function<void(std::error_code)> handler) override {
+        asio::post(m_socket.get_executor(), [handler] { handler({}); });
+    }
+
+    void async_read_until(asio::streambuf &buf, char delim, Handler handler) override {
+        asio::async_read_until(m_socket, buf, delim, handler);
+    }
+
+    void async_read_exactly(asio::streambuf &buf, std::size_t n, Handler handler) override {
+        asio::async_read(m_socket, buf, asio::transfer_exactly(n), handler);
+    }
+
+    void async_write(asio::const_buffer buffer, Handler handler) override {
+        asio::async_write(m_socket, buffer, handler);
+    }
+
+    void connect(const asio::ip::tcp::resolver::results_type &endpoints, const std::string &) override {
+        asio::connect(m_socket, endpoints);
+        m_socket.set_option(asio::ip::tcp::no_delay(true));
+    }
+
+    std::size_t read_until(asio::streambuf &buf, char delim) override {
+        return asio::read_until(m_socket, buf, delim);
+    }
+
+    std::size_t read_exactly(asio::streambuf &buf, std::size_t n) override {
+        return asio::read(m_socket, buf, asio::transfer_exactly(n));
+    }
+
+    void write(asio::const_buffer buffer) override {
+        asio::write(m_socket, buffer);
+    }
+
+    void close() override {
+        asio::error_code ec;
+        m_socket.close(ec);
+    }
+
+  private:
+    asio::ip::tcp::socket m_socket;
+};
+
+#ifdef USE_TLS
+
+using TlsSession = std::shared_ptr<SSL_SESSION>;
+
+class TlsStream : public Stream {
+  public:
+    // A client passes sessionCache to resume the session of its previous
+    // connection; the cache is refreshed when this stream closes.
+    TlsStream(asio::ip::tcp::socket &&socket, asio::ssl::context &context, TlsSession *sessionCache = nullptr)
+        : m_stream(std::move(socket), context), m_sessionCache(sessionCache) {}
+
+    void async_handshake(std::function<void(std::error_code)> handler) override {
+        m_stream.async_handshake(asio::ssl::stream_base::server, handler);
+    }
+
+    void async_read_until(asio::streambuf &buf, char delim, Handler handler) override {
+        asio::async_read_until(m_stream, buf, delim, handler);
+    }
+
+    void async_read_exactly(asio::streambuf &buf, std::size_t n, Handler handler) override {
+        asio::async_read(m_stream, buf, asio::transfer_exactly(n), handler);
+    }
+
+    void async_write(asio::const_buffer buffer, Handler handler) override {
+        asio::async_write(m_stream, buffer, handler);
+    }
+
+    void connect(const asio::ip::tcp::resolver::results_type &endpoints, const std::string &host) override {
+        asio::connect(m_stream.lowest_layer(), endpoints);
+        m_stream.lowest_layer().set_option(asio::ip::tcp::no_delay(true));
+        SSL_set_tlsext_host_name(m_stream.native_handle(), host.c_str());
+        m_stream.set_verify_mode(asio::ssl::verify_peer);
+        m_stream.set_verify_callback(asio::ssl::host_name_verification(host));
+        if (m_sessionCache && *m_sessionCache) {
+            SSL_set_session(m_stream.native_handle(), m_sessionCache->get());
+        }
+        m_stream.handshake(asio::ssl::stream_base::client);
+    }
+
+    std::size_t read_until(asio::streambuf &buf, char delim) override {
+        return asio::read_until(m_stream, buf, delim);
+    }
+
+    std::size_t read_exactly(asio::streambuf &buf, std::size_t n) override {
+        return asio::read(m_stream, buf, asio::transfer_exactly(n));
+    }
+
+    void write(asio::const_buffer buffer) override {
+        asio::write(m_stream, buffer);
+    }
+
+    void close() override {
+        // Marks the connection as shut down, which OpenSSL wants before it
+        // resumes the session. Nothing is sent: asio's engine writes the
+        // close_notify into its memory BIO, and the socket is closed below
+        // without flushing it.
+        SSL_shutdown(m_stream.native_handle());
+        if (m_sessionCache) {
+            // TLS 1.3 tickets arrive after the handshake, so take it late
+            SSL_SESSION *session = SSL_get1_session(m_stream.native_handle());
+            if (session && SSL_SESSION_is_resumable(session)) {
+                m_sessionCache->reset(session, SSL_SESSION_free);
+            } else if (session) {
+                SSL_SESSION_free(session);
+            }
+        }
+        asio::error_code ec;
+        m_stream.lowest_layer().close(ec);
+    }
+
+    bool resumed() {
+        return SSL_session_reused(m_stream.native_handle());
+    }
+
+  private:
+    asio::ssl::stream<asio::ip::tcp::socket> m_stream;
+    TlsSession *m_sessionCache;
+};
+
+#endif
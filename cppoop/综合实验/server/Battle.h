@@ -1,33 +1,44 @@
-#pragma once
-#include "Database.h"
-#include <functional>
-#include <iostream>
-#include <sstream>
-
-using std::string, std::getline, std::cout, std::to_string;
-
-class Battle {
-  public:
-    Battle(Challenger &challenger1,
-           Challenger &challenger2,
-           std::function<void(const std::string &s)> async_write1,
-           std::function<void(const std::string &s)> async_write2);
-
-    bool handle(int side, std::string msg);
-
-    void end(int side);
-
-  private:
-    void makeProblem();
-
-    Challenger &m_challenger1, &m_challenger2;
-    std::function<void(const std::string &s)> m_async_write1, m_async_write2;
-    bool m_ready1 = false, m_ready2 = false;
-
-    std::string m_result1, m_result2;
-    bool m_ended = false;
-
-    int m_level, m_round;
-    Problem m_problem{""};
-    std::string m_problemMsg;
+#pragma once
+#include "Database.h"
+#include "MessageReader.h"
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string_view>
+
+using std::string, std::getline, std::cout, std::to_string;
+
+class Battle {
+  public:
+    Battle(Challenger &challenger1,
+           Challenger &challenger2,
+           std::function<void(const std::string &s)> async_write1,
+           std::function<void(const std::string &s)> async_write2);
+
+    bool handle(int side, std::string_view msg);
+
+    void end(int side);
+
+    // f(winner) is called once when the battle is over, with the side that
+    // won, or 0 for a draw
+    void onEnd(std::function<void(int winner)> f) { m_onEnd = std::move(f); }
+
+  private:
+    void makeProblem();
+    void recordOutcome(int leaver);
+
+    Challenger &m_challenger1, &m_challenger2;
+    std::function<void(const std::string &s)> m_async_write1, m_async_write2;
+    std::function<void(int winner)> m_onEnd;
+    bool m_ready1 = false, m_ready2 = false;
+
+    std::string m_result1, m_result2;
+    bool m_ended = false;
+
+    int m_level, m_round;
+    int m_wins1 = 0, m_wins2 = 0;
+    Problem m_problem{""};
+    ProblemSetPtr m_problemSet;
+    std::chrono::steady_clock::time_point m_problemStartTime;
+    std::string m_problemMsg;
 };
\ No newline at end of file
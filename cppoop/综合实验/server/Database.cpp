@@ -1,151 +1,475 @@
-#include "Database.h"
-#include <algorithm>
-#include <fstream>
-#include <iostream>
-#include <sstream>
-
-Database db;
-
-Database::Database() {
-    std::random_device rd;
-    m_randomEngine.seed(rd());
-}
-
-UserPtr Database::getUserByName(const std::string &name) {
-    auto result = m_users.find(name);
-    if (result == m_users.end()) {
-        return nullptr;
-    } else {
-        return result->second;
-    }
-}
-
-bool Database::addUser(UserPtr user) {
-    if (m_users.find(user->getName()) != m_users.end()) {
-        return false;
-    } else {
-        m_users.emplace(std::make_pair(user->getName(), user));
-        m_unsaved = true;
-        return true;
-    }
-}
-
-bool Database::updateUser(UserPtr user) {
-    auto t = m_users.find(user->getName());
-    if (t == m_users.end()) {
-        return false;
-    } else {
-        t->second = user;
-        m_unsaved = true;
-        return true;
-    }
-}
-
-std::string Database::getUserListForClient() {
-    std::stringstream os;
-    os << "userlist_res\n";
-    os << m_users.size() << "\n";
-    for (const auto &[_, user] : m_users) {
-        if (user->getType() == UserType::challenger) {
-            os << "1\n";
-            os << user->getName() << "\n";
-            auto challenger = std::dynamic_pointer_cast<Challenger>(user);
-            os << challenger->getLevel() << " "
-               << challenger->getExp() << " "
-               << challenger->getExpForNextLevel() << " "
-               << challenger->getLevelPassed() << "\n";
-        } else if (user->getType() == UserType::author) {
-            os << "2\n";
-            os << user->getName() << "\n";
-            auto author = std::dynamic_pointer_cast<Author>(user);
-            os << author->getLevel() << " "
-               << author->getMadeNum() << " "
-               << author->getMadeNumForNextLevel() << "\n";
-        }
-    }
-    return os.str();
-}
-
-bool Database::addProblem(const Problem &problem) {
-    if (m_wordSet.find(problem.word()) != m_wordSet.end()) {
-        return false;
-    }
-    int index = m_problems.size();
-    m_problems.push_back(problem);
-    int length = problem.length();
-    if (length >= m_problemIndexByLength.size()) {
-        m_problemIndexByLength.resize(length + 1);
-    }
-    m_problemIndexByLength[length].push_back(index);
-    m_wordSet.insert(problem.word());
-    m_unsaved = true;
-    return true;
-}
-
-Problem Database::getRandomProblem(int minLength, int maxLength) {
-    minLength = std::min(minLength, static_cast<int>(m_problemIndexByLength.size()) - 1);
-    maxLength = std::min(maxLength, static_cast<int>(m_problemIndexByLength.size()) - 1);
-    int problemCount = 0;
-    for (int i = minLength; i <= maxLength; i++) {
-        problemCount += (int)m_problemIndexByLength[i].size();
-    }
-    if (problemCount == 0) {
-        return Problem("");
-    }
-    std::uniform_int_distribution<> distrib(0, problemCount);
-    int index = distrib(m_randomEngine);
-    for (int i = minLength; i <= maxLength; i++) {
-        if (index < m_problemIndexByLength[i].size()) {
-            return m_problems[m_problemIndexByLength[i][index]];
-        } else {
-            index -= (int)m_problemIndexByLength[i].size();
-        }
-    }
-    return Problem("");
-}
-
-void Database::save() {
-    std::ofstream os("users.tsv");
-    for (const auto &[_, user] : m_users) {
-        os << user->serialize() << "\n";
-    }
-    std::cout << "saved " + std::to_string(m_users.size()) + " user(s)" << std::endl;
-
-    os = std::ofstream("problems.tsv");
-    for (const auto &problem : m_problems) {
-        os << problem.serialize() << "\n";
-    }
-    std::cout << "saved " + std::to_string(m_problems.size()) + " problems(s)" << std::endl;
-
-    m_unsaved = false;
-}
-
-void Database::load() {
-    m_users.clear();
-    std::ifstream is("users.tsv");
-    if (is) {
-        std::string line;
-        while (std::getline(is, line)) {
-            auto user = User::deserialize(line);
-            m_users.emplace(std::make_pair(user->getName(), user));
-        }
-    }
-    std::cout << "loaded " + std::to_string(m_users.size()) + " user(s)" << std::endl;
-
-    m_problems.clear();
-    m_problemIndexByLength.clear();
-    m_wordSet.clear();
-    is = std::ifstream("problems.tsv");
-    if (is) {
-        std::string line;
-        while (std::getline(is, line)) {
-            auto problem = Problem::deserialize(line);
-            addProblem(problem);
-        }
-    }
-    std::cout << "loaded " + std::to_string(m_problems.size()) + " problem(s)" << std::endl;
-}
-
-bool Database::unsaved() {
-    return m_unsaved;
-}
+#include "Database.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+Database db;
+
+const size_t minWordLength = 2;
+const size_t maxWordLength = 30;
+const char *const importDirectory = "imports";
+
+Database::Database() {
+    std::random_device rd;
+    m_randomEngine.seed(rd());
+}
+
+UserPtr Database::getUserByName(const std::string &name) {
+    auto result = m_users.find(name);
+    if (result == m_users.end()) {
+        return nullptr;
+    } else {
+        return result->second;
+    }
+}
+
+bool Database::addUser(UserPtr user) {
+    if (m_users.find(user->getName()) != m_users.end()) {
+        return false;
+    } else {
+        m_users.emplace(std::make_pair(user->getName(), user));
+        m_unsaved = true;
+        return true;
+    }
+}
+
+bool Database::updateUser(UserPtr user) {
+    auto t = m_users.find(user->getName());
+    if (t == m_users.end()) {
+        return false;
+    } else {
+        t->second = user;
+        m_unsaved = true;
+        return true;
+    }
+}
+
+static void writeUserForClient(std::ostream &os, const UserPtr &user) {
+    if (user->getType() == UserType::challenger) {
+        os << "1\n";
+        os << user->getName() << "\n";
+        auto challenger = std::static_pointer_cast<Challenger>(user);
+        os << challenger->getLevel() << " "
+           << challenger->getExp() << " "
+           << challenger->getExpForNextLevel() << " "
+           << challenger->getLevelPassed() << " "
+           << std::lround(challenger->getRating().rating) << "\n";
+    } else if (user->getType() == UserType::author) {
+        os << "2\n";
+        os << user->getName() << "\n";
+        auto author = std::static_pointer_cast<Author>(user);
+        os << author->getLevel() << " "
+           << author->getMadeNum() << " "
+           << author->getMadeNumForNextLevel() << "\n";
+    }
+}
+
+std::string Database::getUserListForClient() {
+    std::stringstream os;
+    os << "userlist_res\n";
+    os << m_users.size() << "\n";
+    for (const auto &[_, user] : m_users) {
+        writeUserForClient(os, user);
+    }
+    return os.str();
+}
+
+bool UserQuery::operator==(const UserQuery &other) const {
+    return type == other.type && sortBy == other.sortBy && ascending == other.ascending
+        && filterBy == other.filterBy && filterText == other.filterText;
+}
+
+// value of a numeric column, see UserQuery
+static long columnValue(const User &user, int column) {
+    if (user.getType() == UserType::challenger) {
+        auto &challenger = static_cast<const Challenger &>(user);
+        switch (column) {
+        case 1: return std::lround(challenger.getRating().rating);
+        case 2: return challenger.getLevel();
+        case 3: return challenger.getExp();
+        case 4: return challenger.getLevelPassed();
+        }
+    } else if (user.getType() == UserType::author) {
+        auto &author = static_cast<const Author &>(user);
+        switch (column) {
+        case 1: return author.getLevel();
+        case 2: return author.getMadeNum();
+        }
+    }
+    return 0;
+}
+
+std::vector<UserPtr> Database::queryUsers(const UserQuery &query) {
+    char *end;
+    long filterValue = std::strtol(query.filterText.c_str(), &end, 10);
+    bool filterIsNumber = !query.filterText.empty() && *end == '\0';
+
+    std::vector<UserPtr> users;
+    for (const auto &[name, user] : m_users) {
+        if (user->getType() != query.type) continue;
+        if (!query.filterText.empty()) {
+            if (query.filterBy == 0) {
+                if (name.find(query.filterText) == std::string::npos) continue;
+            } else if (!filterIsNumber || columnValue(*user, query.filterBy) != filterValue) {
+                continue;
+            }
+        }
+        users.push_back(user);
+    }
+
+    // cache the sort key, the comparisons would look it up O(n log n) times
+    std::vector<std::pair<long, UserPtr>> keyed;
+    keyed.reserve(users.size());
+    for (auto &user : users) {
+        keyed.emplace_back(query.sortBy == 0 ? 0 : columnValue(*user, query.sortBy), std::move(user));
+    }
+    std::sort(keyed.begin(), keyed.end(), [&](const auto &a, const auto &b) {
+        if (a.first != b.first) return query.ascending ? a.first < b.first : a.first > b.first;
+        // ties, including every pair when sorting by name
+        const std::string &nameA = a.second->getName(), &nameB = b.second->getName();
+        return (query.ascending || query.sortBy != 0) ? nameA < nameB : nameA > nameB;
+    });
+    for (size_t i = 0; i < keyed.size(); i++) {
+        users[i] = std::move(keyed[i].second);
+    }
+    return users;
+}
+
+std::string Database::getUserPageForClient(const std::vector<UserPtr> &users, size_t offset, size_t count) {
+    offset = std::min(offset, users.size());
+    count = std::min(count, users.size() - offset);
+    std::stringstream os;
+    os << "userlist_page_res\n";
+    os << users.size() << " " << offset << "\n";
+    os << count << "\n";
+    for (size_t i = offset; i < offset + count; i++) {
+        writeUserForClient(os, users[i]);
+    }
+    return os.str();
+}
+
+ProblemSetPtr Database::getProblemSet() const {
+    return std::atomic_load(&m_problemSet);
+}
+
+// One edit apart is usually a misspelling or a spelling variant, like
+// colour and color. Short words are left alone, house and horse are both
+// fine, so a pair is only too close when one of them has 6 letters or more.
+ProblemReview Database::reviewProblem(const std::string &word, const ProblemSet &problemSet, const WordTrie &pending,
+                                      bool checkSimilar) const {
+    ProblemReview review;
+    review.word = word;
+    if (!std::all_of(word.begin(), word.end(), [](char c) { return c >= 'a' && c <= 'z'; })) {
+        review.verdict = ProblemVerdict::badCharacter;
+    } else if (word.size() < minWordLength || word.size() > maxWordLength) {
+        review.verdict = ProblemVerdict::badLength;
+    } else if (m_hasDictionary && !m_dictionary.contains(word)) {
+        review.verdict = ProblemVerdict::unknownWord;
+    } else if (problemSet.contains(word) || pending.contains(word)) {
+        review.verdict = ProblemVerdict::duplicate;
+        review.conflict = word;
+    } else if (checkSimilar && word.size() >= 5) {
+        size_t minLength = word.size() >= 6 ? 0 : 6;
+        review.conflict = problemSet.findSimilar(word, 1, minLength);
+        if (review.conflict.empty()) {
+            review.conflict = pending.findWithin(word, 1, minLength);
+        }
+        if (!review.conflict.empty()) {
+            review.verdict = ProblemVerdict::similar;
+        }
+    }
+    return review;
+}
+
+void Database::addProblems(std::vector<std::string> words, std::function<void(std::vector<ProblemReview>)> callback,
+                           bool checkSimilar) {
+    std::lock_guard<std::mutex> lock(m_reviewMutex);
+    m_reviewQueue.push_back({std::move(words), std::move(callback), checkSimilar});
+    m_reviewReady.notify_one();
+}
+
+void Database::startProblemReviewer() {
+    std::thread(&Database::reviewProblems, this).detach();
+}
+
+void Database::reviewProblems() {
+    for (;;) {
+        std::deque<ReviewBatch> batches;
+        {
+            std::unique_lock<std::mutex> lock(m_reviewMutex);
+            m_reviewReady.wait(lock, [this] { return !m_reviewQueue.empty(); });
+            batches.swap(m_reviewQueue);
+        }
+        reviewBatches(batches);
+    }
+}
+
+int Database::runQueuedReviews() {
+    std::deque<ReviewBatch> batches;
+    {
+        std::lock_guard<std::mutex> lock(m_reviewMutex);
+        batches.swap(m_reviewQueue);
+    }
+    reviewBatches(batches);
+    return (int)batches.size();
+}
+
+// The batches waiting together are published as one new set, so words made
+// one at a time do not each copy the set.
+void Database::reviewBatches(std::deque<ReviewBatch> &batches) {
+    auto problemSet = getProblemSet();
+    WordTrie pending;
+    std::vector<std::vector<ProblemReview>> reviews(batches.size());
+    std::vector<Problem> accepted;
+    // the batch and position of each accepted word
+    std::vector<std::pair<size_t, size_t>> acceptedAt;
+    for (size_t i = 0; i < batches.size(); i++) {
+        for (const auto &word : batches[i].words) {
+            reviews[i].push_back(reviewProblem(word, *problemSet, pending, batches[i].checkSimilar));
+            if (reviews[i].back().verdict == ProblemVerdict::accepted) {
+                pending.insert(word);
+                accepted.push_back(Problem(word));
+                acceptedAt.emplace_back(i, reviews[i].size() - 1);
+            }
+        }
+    }
+    if (!accepted.empty()) {
+        std::vector<bool> added;
+        publishProblems(accepted, &added);
+        for (size_t i = 0; i < added.size(); i++) {
+            // the set was reloaded meanwhile with the word in it
+            if (!added[i]) {
+                auto &review = reviews[acceptedAt[i].first][acceptedAt[i].second];
+                review.verdict = ProblemVerdict::duplicate;
+                review.conflict = review.word;
+            }
+        }
+    }
+    for (size_t i = 0; i < batches.size(); i++) {
+        batches[i].callback(std::move(reviews[i]));
+    }
+}
+
+std::vector<std::string> Database::getProblemsWithPrefix(const std::string &prefix, size_t limit) const {
+    return getProblemSet()->withPrefix(prefix, limit);
+}
+
+Problem Database::getRandomProblem(const ProblemSetPtr &problemSet, double minDifficulty, double maxDifficulty) {
+    return problemSet->getRandomProblem(minDifficulty, maxDifficulty, m_randomEngine);
+}
+
+void Database::recordAttempt(const Problem &problem, bool solved, int solveTime) {
+    m_problemStats.record(problem.index(), solved, solveTime);
+}
+
+void Database::updateDifficulty() {
+    auto current = getProblemSet();
+    for (;;) {
+        auto next = std::make_shared<ProblemSet>(*current);
+        next->rescore(m_problemStats);
+        ProblemSetPtr published = next;
+        if (std::atomic_compare_exchange_strong(&m_problemSet, &current, published)) {
+            return;
+        }
+    }
+}
+
+void Database::recordBattle(const Challenger &challenger1, const Challenger &challenger2, double score1) {
+    m_ratingSystem.enqueue(challenger1.getName(), challenger1.getRating(),
+                           challenger2.getName(), challenger2.getRating(), score1);
+}
+
+void Database::startRatingUpdater(std::chrono::seconds periodLength, RatingSystem::Post post) {
+    m_ratingSystem.start(periodLength, post, [this](const RatingSystem::Results &results) {
+        for (const auto &[name, rating] : results) {
+            auto user = getUserByName(name);
+            if (user && user->getType() == UserType::challenger) {
+                std::static_pointer_cast<Challenger>(user)->setRating(rating);
+            }
+        }
+        if (unsaved()) {
+            save();
+        }
+    });
+}
+
+void Database::startDifficultyUpdater(std::chrono::seconds interval) {
+    std::thread([this, interval] {
+        for (;;) {
+            std::this_thread::sleep_for(interval);
+            updateDifficulty();
+        }
+    }).detach();
+}
+
+void Database::checkpointGame(const std::string &name, const GameState &state) {
+    m_games.put(name, state);
+}
+
+void Database::clearGame(const std::string &name) {
+    m_games.erase(name);
+}
+
+std::optional<GameState> Database::getSavedGame(const std::string &name) {
+    return m_games.get(name);
+}
+
+void Database::setGameStore(std::unique_ptr<GameStore> store) {
+    m_games.setStore(std::move(store));
+}
+
+void Database::startGameCheckpointer(std::chrono::milliseconds interval) {
+    m_games.start(interval);
+}
+
+void Database::flushGames() {
+    m_games.flush();
+}
+
+static std::string describeRejection(const ProblemReview &review) {
+    switch (review.verdict) {
+    case ProblemVerdict::accepted:
+        return "";
+    case ProblemVerdict::badCharacter:
+        return "not only lowercase letters";
+    case ProblemVerdict::badLength:
+        return "too short or too long";
+    case ProblemVerdict::unknownWord:
+        return "not in the dictionary";
+    case ProblemVerdict::duplicate:
+        return "already a problem";
+    case ProblemVerdict::similar:
+        return "too close to " + review.conflict;
+    }
+    return "";
+}
+
+void Database::importProblems(const std::string &name, std::function<void(int, int)> callback) {
+    // only a plain file name, so an author cannot have any file read
+    if (name.empty() || name == "." || name == ".." || name.find_first_of("/\\:") != std::string::npos) {
+        callback(-1, getProblemSet()->size());
+        return;
+    }
+    std::string path = std::string(importDirectory) + "/" + name;
+    std::thread([this, path, callback] {
+        std::ifstream is(path);
+        if (!is) {
+            callback(-1, getProblemSet()->size());
+            return;
+        }
+        std::vector<std::string> words;
+        std::string word;
+        while (std::getline(is, word)) {
+            if (!word.empty() && word.back() == '\r') word.pop_back();
+            if (!word.empty()) words.push_back(word);
+        }
+        addProblems(std::move(words), [this, path, callback](std::vector<ProblemReview> reviews) {
+            int imported = 0;
+            std::string skipped;
+            for (const auto &review : reviews) {
+                if (review.verdict == ProblemVerdict::accepted) {
+                    imported++;
+                } else {
+                    skipped += "skipped " + review.word + ": " + describeRejection(review) + "\n";
+                }
+            }
+            std::cout << skipped + "imported " + std::to_string(imported) + " problem(s) from " + path << std::endl;
+            callback(imported, getProblemSet()->size());
+        }, false);
+    }).detach();
+}
+
+// Copy-on-write: build the next set aside and swap it in, retrying if
+// another writer published first. Readers keep whatever snapshot they hold.
+int Database::publishProblems(const std::vector<Problem> &problems, std::vector<bool> *addedEach) {
+    auto current = getProblemSet();
+    for (;;) {
+        auto next = std::make_shared<ProblemSet>(*current);
+        int added = next->add(problems, addedEach);
+        if (added == 0) {
+            return 0;
+        }
+        next->updateIndex();
+        // the whole set is written each time, so a failed write is made
+        // good by the next one
+        saveProblems(*next);
+        ProblemSetPtr published = next;
+        if (std::atomic_compare_exchange_strong(&m_problemSet, &current, published)) {
+            return added;
+        }
+    }
+}
+
+void Database::save() {
+    std::ofstream os("users.tsv");
+    for (const auto &[_, user] : m_users) {
+        os << user->serialize() << "\n";
+    }
+    std::cout << "saved " + std::to_string(m_users.size()) + " user(s)" << std::endl;
+
+    m_unsaved = false;
+}
+
+// The published set may be a mapping of problems.tsv, so write a new file and
+// rename it over instead of truncating in place.
+bool Database::saveProblems(const ProblemSet &problemSet) {
+    std::ofstream os("problems.tsv.tmp");
+    for (int i = 0; i < problemSet.size(); i++) {
+        os << problemSet.problem(i).word() << "\n";
+    }
+    os.close();
+    std::error_code ec;
+    std::filesystem::rename("problems.tsv.tmp", "problems.tsv", ec);
+    if (ec) {
+        std::cout << "failed to save problems: " << ec.message() << std::endl;
+        return false;
+    }
+    std::cout << "saved " + std::to_string(problemSet.size()) + " problems(s)" << std::endl;
+    return true;
+}
+
+void Database::load() {
+    m_users.clear();
+    std::ifstream is("users.tsv");
+    if (is) {
+        std::string line;
+        while (std::getline(is, line)) {
+            auto user = User::deserialize(line);
+            if (user == nullptr) {
+                std::cout << "skipped bad user line: " << line << std::endl;
+                continue;
+            }
+            m_users.emplace(std::make_pair(user->getName(), user));
+        }
+    }
+    std::cout << "loaded " + std::to_string(m_users.size()) + " user(s)" << std::endl;
+
+    auto problemSet = ProblemSet::load("problems.tsv");
+    if (problemSet == nullptr) {
+        problemSet = std::make_shared<ProblemSet>();
+    }
+    std::atomic_store(&m_problemSet, ProblemSetPtr(problemSet));
+    std::cout << "loaded " + std::to_string(problemSet->size()) + " problem(s)" << std::endl;
+
+    m_dictionary = WordTrie();
+    is = std::ifstream("dictionary.txt");
+    m_hasDictionary = (bool)is;
+    if (is) {
+        std::vector<std::string> words;
+        std::string word;
+        while (std::getline(is, word)) {
+            if (!word.empty() && word.back() == '\r') word.pop_back();
+            words.push_back(word);
+        }
+        size_t count = m_dictionary.insert(std::vector<std::string_view>(words.begin(), words.end()));
+        std::cout << "loaded " + std::to_string(count) + " dictionary word(s)" << std::endl;
+    }
+}
+
+bool Database::unsaved() {
+    return m_unsaved;
+}
@@ -1,39 +1,141 @@
-#pragma once
-#include "Problem.h"
-#include "User.h"
-#include <unordered_map>
-#include <unordered_set>
-#include <vector>
-#include <random>
-
-class Database {
-  public:
-    Database();
-
-    UserPtr getUserByName(const std::string &name);
-    bool addUser(UserPtr user);
-    bool updateUser(UserPtr user);
-    std::string getUserListForClient();
-
-    bool addProblem(const Problem &problem);
-    Problem getRandomProblem(int minLength, int maxLength);
-
-    void save();
-    void load();
-    bool unsaved();
-
-  private:
-    friend class Challenger;
-    friend class Author;
-
-
-    std::unordered_map<std::string, UserPtr> m_users;
-    std::vector<Problem> m_problems;
-    std::vector<std::vector<int>> m_problemIndexByLength;
-    std::unordered_set<std::string> m_wordSet;
-    bool m_unsaved = false;
-    
-    std::default_random_engine m_randomEngine;
-};
-
-extern Database db;
+#pragma once
+#include "GameStore.h"
+#include "Problem.h"
+#include "ProblemSet.h"
+#include "Rating.h"
+#include "User.h"
+#include "WordTrie.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <random>
+
+// The users one leaderboard view shows, in the order shown. Columns are
+// those of the client's table: 0 is the name, then rating, level, exp and
+// levels passed for challengers, or level and problems made for authors.
+struct UserQuery {
+    UserType type = UserType::challenger;
+    int sortBy = 1;
+    bool ascending = false;
+    int filterBy = 0;
+    // a substring of the name, or the exact value of another column
+    std::string filterText;
+
+    bool operator==(const UserQuery &other) const;
+};
+
+enum class ProblemVerdict { accepted, badCharacter, badLength, unknownWord, duplicate, similar };
+
+struct ProblemReview {
+    std::string word;
+    ProblemVerdict verdict = ProblemVerdict::accepted;
+    // the existing word for duplicate and similar
+    std::string conflict;
+};
+
+class Database {
+  public:
+    Database();
+
+    UserPtr getUserByName(const std::string &name);
+    bool addUser(UserPtr user);
+    bool updateUser(UserPtr user);
+    std::string getUserListForClient();
+    std::vector<UserPtr> queryUsers(const UserQuery &query);
+    // a slice of a queryUsers() result, with the users' current state
+    std::string getUserPageForClient(const std::vector<UserPtr> &users, size_t offset, size_t count);
+
+    ProblemSetPtr getProblemSet() const;
+    // Reviews words on the review thread, publishes the accepted ones and
+    // calls callback(reviews) there, in the order given. Batches are reviewed
+    // one at a time, so a batch sees earlier ones; those queued together are
+    // published as one new problem set. Without checkSimilar, words one edit
+    // away from another are accepted too.
+    void addProblems(std::vector<std::string> words, std::function<void(std::vector<ProblemReview>)> callback,
+                     bool checkSimilar = true);
+    void startProblemReviewer();
+    // reviews the queued batches on the calling thread instead, for when
+    // the reviewer is not started; returns how many there were
+    int runQueuedReviews();
+    std::vector<std::string> getProblemsWithPrefix(const std::string &prefix, size_t limit) const;
+    Problem getRandomProblem(const ProblemSetPtr &problemSet, double minDifficulty, double maxDifficulty);
+
+    // solveTime in 0.1s, counted only when solved
+    void recordAttempt(const Problem &problem, bool solved, int solveTime);
+    // Rescores every problem from the recorded attempts and publishes the
+    // result. startDifficultyUpdater() runs it periodically off the I/O thread.
+    void updateDifficulty();
+    void startDifficultyUpdater(std::chrono::seconds interval);
+
+    // score1 is challenger1's share of the battle, from 0 to 1
+    void recordBattle(const Challenger &challenger1, const Challenger &challenger2, double score1);
+    // post runs a function on the I/O thread, where new ratings are applied
+    void startRatingUpdater(std::chrono::seconds periodLength, RatingSystem::Post post);
+
+    // Reads one word per line from the file name in imports/ on a background
+    // thread and reviews the words as one batch of addProblems(), without the
+    // similarity check, as word lists hold inflections. callback(
+    // imported, total) is called on the review thread, or at once if name is
+    // not a plain file name; imported is -1 if the file cannot be opened.
+    void importProblems(const std::string &name, std::function<void(int, int)> callback);
+
+    // Games in progress, so a challenger can go on with one after
+    // reconnecting, to this server or another sharing the store. Checkpoints
+    // reach the store when startGameCheckpointer() next flushes them.
+    void checkpointGame(const std::string &name, const GameState &state);
+    void clearGame(const std::string &name);
+    std::optional<GameState> getSavedGame(const std::string &name);
+    // the store is games/ unless set before starting
+    void setGameStore(std::unique_ptr<GameStore> store);
+    void startGameCheckpointer(std::chrono::milliseconds interval);
+    void flushGames();
+
+    void save();
+    void load();
+    bool unsaved();
+
+  private:
+    friend class Challenger;
+    friend class Author;
+
+
+    // Writes problems.tsv on the calling thread before the new problems are
+    // published. addedEach, if given, tells which of them were not in the
+    // set yet.
+    int publishProblems(const std::vector<Problem> &problems, std::vector<bool> *addedEach = nullptr);
+    bool saveProblems(const ProblemSet &problemSet);
+    // words are also checked against pending, the accepted words of the batch
+    ProblemReview reviewProblem(const std::string &word, const ProblemSet &problemSet, const WordTrie &pending,
+                                bool checkSimilar) const;
+    struct ReviewBatch {
+        std::vector<std::string> words;
+        std::function<void(std::vector<ProblemReview>)> callback;
+        bool checkSimilar = true;
+    };
+    void reviewProblems();
+    void reviewBatches(std::deque<ReviewBatch> &batches);
+
+    std::unordered_map<std::string, UserPtr> m_users;
+    ProblemSetPtr m_problemSet = std::make_shared<ProblemSet>();
+    ProblemStats m_problemStats;
+    RatingSystem m_ratingSystem;
+    bool m_unsaved = false;
+
+    // dictionary.txt, one word per line; without it any word is accepted
+    WordTrie m_dictionary;
+    bool m_hasDictionary = false;
+    std::mutex m_reviewMutex;
+    std::condition_variable m_reviewReady;
+    std::deque<ReviewBatch> m_reviewQueue;
+
+    GameCheckpoints m_games{std::make_unique<FileGameStore>("games")};
+    
+    std::default_random_engine m_randomEngine;
+};
+
+extern Database db;
@@ -0,0 +1,98 @@
+#include "GameStore.h"
+#include <fstream>
+#include <iostream>
+#include <system_error>
+#include <thread>
+
+FileGameStore::FileGameStore(std::filesystem::path directory) : m_directory(std::move(directory)) {}
+
+std::filesystem::path FileGameStore::pathOf(const std::string &name) const {
+    static const char digits[] = "0123456789abcdef";
+    std::string file;
+    for (unsigned char c : name) {
+        file += digits[c >> 4];
+        file += digits[c & 15];
+    }
+    return m_directory / file;
+}
+
+std::optional<GameState> FileGameStore::read(const std::string &name) {
+    std::ifstream is(pathOf(name));
+    GameState state;
+    if (!(is >> state.level >> state.round >> state.retry >> state.levelTime)) {
+        return std::nullopt;
+    }
+    if (state.level < 1 || state.round < 1 || state.retry < 0 || state.retry > 2 || state.levelTime < 0) {
+        return std::nullopt;
+    }
+    // missing until the problem of the round is shown
+    is >> state.word;
+    return state;
+}
+
+void FileGameStore::write(const std::string &name, const GameState &state) {
+    auto path = pathOf(name);
+    auto tmpPath = path;
+    tmpPath += ".tmp";
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    std::ofstream(tmpPath) << state.level << " " << state.round << " " << state.retry << " " << state.levelTime << " " << state.word << "\n";
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        std::cout << "failed to save game of " + name + ": " + ec.message() << std::endl;
+    }
+}
+
+void FileGameStore::erase(const std::string &name) {
+    std::error_code ec;
+    std::filesystem::remove(pathOf(name), ec);
+}
+
+void GameCheckpoints::put(const std::string &name, const GameState &state) {
+    std::lock_guard lock(m_mutex);
+    m_pending[name] = state;
+}
+
+void GameCheckpoints::erase(const std::string &name) {
+    std::lock_guard lock(m_mutex);
+    m_pending[name] = std::nullopt;
+}
+
+std::optional<GameState> GameCheckpoints::get(const std::string &name) {
+    {
+        std::lock_guard lock(m_mutex);
+        for (const Pending *pending : {&m_pending, &m_writing}) {
+            auto it = pending->find(name);
+            if (it != pending->end()) return it->second;
+        }
+    }
+    std::lock_guard lock(m_storeMutex);
+    return m_store->read(name);
+}
+
+void GameCheckpoints::flush() {
+    std::lock_guard storeLock(m_storeMutex);
+    {
+        std::lock_guard lock(m_mutex);
+        if (m_pending.empty()) return;
+        m_writing.swap(m_pending);
+    }
+    for (const auto &[name, state] : m_writing) {
+        if (state) {
+            m_store->write(name, *state);
+        } else {
+            m_store->erase(name);
+        }
+    }
+    std::lock_guard lock(m_mutex);
+    m_writing.clear();
+}
+
+void GameCheckpoints::start(std::chrono::milliseconds interval) {
+    std::thread([this, interval] {
+        for (;;) {
+            std::this_thread::sleep_for(interval);
+            flush();
+        }
+    }).detach();
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// Where a challenger is in a single-player game, enough to carry on from
+// the start of the round they were on.
+struct GameState {
+    int level = 1, round = 1, retry = 2;
+    // time already spent on the level, in 0.1s
+    int levelTime = 0;
+    // the problem of the round once it has been shown, so going on shows
+    // it again instead of a new one
+    std::string word;
+};
+
+// Storage of the games in progress, one record per challenger. Calls come
+// from one thread at a time.
+class GameStore {
+  public:
+    virtual ~GameStore() = default;
+    virtual std::optional<GameState> read(const std::string &name) = 0;
+    virtual void write(const std::string &name, const GameState &state) = 0;
+    virtual void erase(const std::string &name) = 0;
+};
+
+// A file of one line per challenger in directory, named by the hex of the
+// name. Servers given the same directory can pick up each other's games.
+class FileGameStore : public GameStore {
+  public:
+    explicit FileGameStore(std::filesystem::path directory);
+
+    std::optional<GameState> read(const std::string &name) override;
+    void write(const std::string &name, const GameState &state) override;
+    void erase(const std::string &name) override;
+
+  private:
+    std::filesystem::path pathOf(const std::string &name) const;
+
+    std::filesystem::path m_directory;
+};
+
+// Checkpoints are kept in memory and written out together by flush(), so
+// one taken every round costs a map assignment on the I/O thread, and only
+// the last of a player's checkpoints between flushes reaches the store.
+class GameCheckpoints {
+  public:
+    explicit GameCheckpoints(std::unique_ptr<GameStore> store) : m_store(std::move(store)) {}
+
+    // only before start()
+    void setStore(std::unique_ptr<GameStore> store) { m_store = std::move(store); }
+    void put(const std::string &name, const GameState &state);
+    void erase(const std::string &name);
+    std::optional<GameState> get(const std::string &name);
+
+    void flush();
+    // flushes every interval on a thread of its own
+    void start(std::chrono::milliseconds interval);
+
+  private:
+    // nullopt for a game that was ended
+    using Pending = std::unordered_map<std::string, std::optional<GameState>>;
+
+    std::unique_ptr<GameStore> m_store;
+    std::mutex m_mutex;
+    Pending m_pending;
+    // taken out of m_pending by a flush still writing them
+    Pending m_writing;
+    std::mutex m_storeMutex;
+};
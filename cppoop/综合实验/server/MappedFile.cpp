@@ -0,0 +1,77 @@
+#include "MappedFile.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFilePtr MappedFile::open(const std::string &path) {
+    std::shared_ptr<MappedFile> file(new MappedFile);
+    // FILE_SHARE_DELETE lets saveProblems() rename a new problems.tsv over this one
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                                nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+    file->m_file = handle;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        return nullptr;
+    }
+    file->m_size = (size_t)size.QuadPart;
+    if (file->m_size == 0) {
+        return file;
+    }
+    file->m_mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (file->m_mapping == nullptr) {
+        return nullptr;
+    }
+    file->m_data = static_cast<const char *>(MapViewOfFile(file->m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (file->m_data == nullptr) {
+        return nullptr;
+    }
+    return file;
+}
+
+MappedFile::~MappedFile() {
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file) CloseHandle(m_file);
+}
+
+#else
+
+MappedFilePtr MappedFile::open(const std::string &path) {
+    std::shared_ptr<MappedFile> file(new MappedFile);
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return nullptr;
+    }
+    file->m_size = (size_t)st.st_size;
+    if (file->m_size > 0) {
+        void *data = mmap(nullptr, file->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return nullptr;
+        }
+        file->m_data = static_cast<const char *>(data);
+    }
+    close(fd);
+    return file;
+}
+
+MappedFile::~MappedFile() {
+    if (m_data) munmap(const_cast<char *>(m_data), m_size);
+}
+
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+
+class MappedFile;
+using MappedFilePtr = std::shared_ptr<const MappedFile>;
+
+// Read-only memory mapping of a whole file. The file may be replaced by
+// rename while mapped; the mapping keeps seeing the old contents.
+class MappedFile {
+  public:
+    static MappedFilePtr open(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    std::string_view data() const { return {m_data, m_size}; }
+
+  private:
+    MappedFile() = default;
+
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void *m_file = nullptr;
+    void *m_mapping = nullptr;
+#endif
+};
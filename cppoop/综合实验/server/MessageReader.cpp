@@ -0,0 +1,45 @@
+#include "MessageReader.h"
+#include <algorithm>
+#include <charconv>
+
+std::string_view MessageReader::line() {
+    if (m_failed || m_rest.empty()) {
+        m_failed = true;
+        return {};
+    }
+    size_t end = m_rest.find('\n');
+    std::string_view line = m_rest.substr(0, end);
+    m_rest.remove_prefix(end == std::string_view::npos ? m_rest.size() : end + 1);
+    return line;
+}
+
+template <class T> MessageReader &MessageReader::readNumber(T &value) {
+    value = 0;
+    if (m_failed) return *this;
+    size_t begin = m_rest.find_first_not_of(" \t\n\v\f\r");
+    m_rest.remove_prefix(begin == std::string_view::npos ? m_rest.size() : begin);
+    if (!m_rest.empty() && m_rest[0] == '+') m_rest.remove_prefix(1);
+    auto [end, ec] = std::from_chars(m_rest.data(), m_rest.data() + m_rest.size(), value);
+    if (ec != std::errc()) {
+        value = 0;
+        m_failed = true;
+    }
+    m_rest.remove_prefix(end - m_rest.data());
+    return *this;
+}
+
+MessageReader &MessageReader::operator>>(int &value) { return readNumber(value); }
+MessageReader &MessageReader::operator>>(unsigned long &value) { return readNumber(value); }
+MessageReader &MessageReader::operator>>(unsigned long long &value) { return readNumber(value); }
+
+MessageReader &MessageReader::operator>>(bool &value) {
+    int number = 0;
+    readNumber(number);
+    value = number == 1;
+    if (number != 0 && number != 1) m_failed = true;
+    return *this;
+}
+
+void MessageReader::ignore(size_t count) {
+    m_rest.remove_prefix(std::min(count, m_rest.size()));
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+
+// Reads a received message in place, in the way the handlers used to read
+// it with an istringstream: a number skips the whitespace before it, line()
+// takes the rest of the current line, and once a read has failed every
+// later one fails too, giving 0 or an empty line.
+class MessageReader {
+  public:
+    explicit MessageReader(std::string_view msg) : m_rest(msg) {}
+
+    // up to the next '\n', which is skipped; fails at the end of the message
+    std::string_view line();
+    MessageReader &operator>>(int &value);
+    MessageReader &operator>>(unsigned long &value);
+    MessageReader &operator>>(unsigned long long &value);
+    // 0 or 1
+    MessageReader &operator>>(bool &value);
+    void ignore(size_t count = 1);
+
+    explicit operator bool() const { return !m_failed; }
+
+  private:
+    template <class T> MessageReader &readNumber(T &value);
+
+    std::string_view m_rest;
+    bool m_failed = false;
+};
@@ -1,15 +1,21 @@
-#pragma once
-#include <string>
-
-class Problem {
-  public:
-    Problem(const std::string &word) : m_word(word) {}
-    std::string word() const { return m_word; }
-    int length() const { return (int)m_word.length(); }
-    bool empty() const { return m_word.empty(); }
-    std::string serialize() const { return m_word; }
-    static Problem deserialize(const std::string &str) { return Problem(str); }
-
-  private:
-    std::string m_word;
+#pragma once
+#include <string>
+#include <string_view>
+
+// A view into the word data owned by a ProblemSet. Only valid while the
+// ProblemSet it came from is alive.
+class Problem {
+  public:
+    Problem(std::string_view word, int index = -1) : m_word(word), m_index(index) {}
+    std::string_view word() const { return m_word; }
+    // position in the ProblemSet, stable across later snapshots; -1 if not in one
+    int index() const { return m_index; }
+    int length() const { return (int)m_word.length(); }
+    bool empty() const { return m_word.empty(); }
+    std::string serialize() const { return std::string(m_word); }
+    static Problem deserialize(std::string_view str) { return Problem(str); }
+
+  private:
+    std::string_view m_word;
+    int m_index;
 };
\ No newline at end of file
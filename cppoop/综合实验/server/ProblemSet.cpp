@@ -0,0 +1,207 @@
+#include "ProblemSet.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <unordered_set>
+
+ProblemSet::ProblemSet(const ProblemSet &other)
+    : m_file(other.m_file), m_chunks(other.m_chunks), m_chunkUsed(other.m_chunkUsed),
+      m_offsets(other.m_offsets), m_size(other.m_size),
+      m_ranks(other.m_ranks), m_unranked(other.m_unranked),
+      m_words(other.m_words) {
+    // the last chunks may be filled further by either set, so each gets its own
+    if (m_chunkUsed < chunkSize) {
+        std::shared_ptr<char[]> chunk(new char[chunkSize]);
+        std::memcpy(chunk.get(), m_chunks.back().get(), m_chunkUsed);
+        m_chunks.back() = chunk;
+    }
+    if (m_size % offsetChunkSize != 0) {
+        m_offsets.back() = std::make_shared<std::vector<uint32_t>>(*m_offsets.back());
+    }
+}
+
+std::shared_ptr<ProblemSet> ProblemSet::load(const std::string &path) {
+    auto problemSet = std::make_shared<ProblemSet>();
+    problemSet->m_file = MappedFile::open(path);
+    if (problemSet->m_file == nullptr) {
+        return nullptr;
+    }
+    std::string_view data = problemSet->m_file->data();
+    std::vector<Problem> problems;
+    while (!data.empty()) {
+        size_t end = data.find('\n');
+        std::string_view line = data.substr(0, end);
+        data.remove_prefix(end == std::string_view::npos ? data.size() : end + 1);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        problems.push_back(Problem::deserialize(line));
+    }
+    problemSet->add(problems);
+    problemSet->updateIndex();
+    return problemSet;
+}
+
+static bool isLineOf(std::string_view word, std::string_view file) {
+    std::less_equal<const char *> notAfter;
+    if (file.empty() || !notAfter(file.data(), word.data())
+        || !notAfter(word.data() + word.size(), file.data() + file.size())) {
+        return false;
+    }
+    std::string_view rest = file.substr(word.data() - file.data() + word.size());
+    return rest.substr(0, 1) == "\n" || rest.substr(0, 2) == "\r\n";
+}
+
+// A word that is a whole line of the mapped file is kept there; the rest,
+// like the last line if it has no '\n', are copied into the chunks.
+int ProblemSet::add(const std::vector<Problem> &problems, std::vector<bool> *addedEach) {
+    if (addedEach) addedEach->assign(problems.size(), false);
+    std::string_view file = m_file ? m_file->data() : std::string_view();
+    std::unordered_set<std::string_view> seen;
+    std::vector<std::string_view> added;
+    for (size_t i = 0; i < problems.size(); i++) {
+        std::string_view word = problems[i].word();
+        if (word.empty() || word.size() > WordTrie::maxWordLength || word.find_first_of("\r\n") != std::string_view::npos
+            || contains(word) || !seen.insert(word).second) {
+            continue;
+        }
+        if (isLineOf(word, file)) {
+            append((uint32_t)(word.data() - file.data()));
+        } else {
+            append(store(word));
+        }
+        m_unranked.push_back({(float)word.size(), (int)m_size - 1});
+        added.push_back(word);
+        if (addedEach) (*addedEach)[i] = true;
+    }
+    m_words.insert(added);
+    return (int)added.size();
+}
+
+bool ProblemSet::contains(std::string_view word) const {
+    return m_words.contains(word);
+}
+
+std::vector<std::string> ProblemSet::withPrefix(std::string_view prefix, size_t limit) const {
+    return m_words.withPrefix(prefix, limit);
+}
+
+std::string ProblemSet::findSimilar(std::string_view word, int maxDistance, size_t minLength) const {
+    return m_words.findWithin(word, maxDistance, minLength);
+}
+
+uint32_t ProblemSet::store(std::string_view word) {
+    if (m_chunkUsed + word.size() + 1 > chunkSize) {
+        m_chunks.emplace_back(new char[chunkSize]);
+        m_chunkUsed = 0;
+    }
+    size_t fileSize = m_file ? m_file->data().size() : 0;
+    size_t offset = fileSize + (m_chunks.size() - 1) * chunkSize + m_chunkUsed;
+    char *p = m_chunks.back().get() + m_chunkUsed;
+    std::memcpy(p, word.data(), word.size());
+    p[word.size()] = '\n';
+    m_chunkUsed += word.size() + 1;
+    return (uint32_t)offset;
+}
+
+std::string_view ProblemSet::word(uint32_t offset) const {
+    size_t fileSize = m_file ? m_file->data().size() : 0;
+    const char *p = offset < fileSize ? m_file->data().data() + offset
+                                      : m_chunks[(offset - fileSize) / chunkSize].get() + (offset - fileSize) % chunkSize;
+    size_t length = (const char *)std::memchr(p, '\n', WordTrie::maxWordLength + 2) - p;
+    if (length > 0 && p[length - 1] == '\r') length--;
+    return {p, length};
+}
+
+void ProblemSet::append(uint32_t offset) {
+    if (m_size % offsetChunkSize == 0) {
+        m_offsets.push_back(std::make_shared<std::vector<uint32_t>>());
+        m_offsets.back()->reserve(offsetChunkSize);
+    }
+    m_offsets.back()->push_back(offset);
+    m_size++;
+}
+
+void ProblemSet::updateIndex() {
+    if (m_unranked.empty()) return;
+    std::sort(m_unranked.begin(), m_unranked.end());
+    m_ranks.push_back(std::make_shared<const std::vector<Rank>>(std::move(m_unranked)));
+    m_unranked.clear();
+    while (m_ranks.size() >= 2 && m_ranks[m_ranks.size() - 2]->size() <= 2 * m_ranks.back()->size()) {
+        const auto &first = *m_ranks[m_ranks.size() - 2], &second = *m_ranks.back();
+        auto merged = std::make_shared<std::vector<Rank>>();
+        merged->reserve(first.size() + second.size());
+        std::merge(first.begin(), first.end(), second.begin(), second.end(), std::back_inserter(*merged));
+        m_ranks.pop_back();
+        m_ranks.back() = merged;
+    }
+}
+
+// Difficulty is length adjusted by how often the word is failed and how long
+// it takes to solve, both relative to the whole set. Observations are blended
+// with the set average (weight priorAttempts) so rarely seen words stay close
+// to their length. The adjustments are bounded to +-4 and +-2 length units.
+void ProblemSet::rescore(const ProblemStats &stats) {
+    const double priorAttempts = 5;
+    uint64_t attempts = 0, successes = 0, solveTime = 0;
+    for (int i = 0; i < size(); i++) {
+        auto entry = stats.get(i);
+        attempts += entry.attempts;
+        successes += entry.successes;
+        solveTime += entry.solveTime;
+    }
+    if (attempts == 0 || successes == 0) return;
+    double failRate = 1 - (double)successes / attempts;
+    double meanTime = (double)solveTime / successes;
+
+    std::vector<Rank> ranks(m_size);
+    for (int i = 0; i < size(); i++) {
+        auto entry = stats.get(i);
+        double wordFailRate = (entry.attempts - entry.successes + priorAttempts * failRate) / (entry.attempts + priorAttempts);
+        double wordTime = (entry.solveTime + priorAttempts * meanTime) / (entry.successes + priorAttempts);
+        double timeRatio = std::min(wordTime / meanTime, 2.0);
+        ranks[i].index = i;
+        ranks[i].difficulty = (float)(problem(i).length()
+                                      + 4 * (wordFailRate - failRate)
+                                      + 2 * (timeRatio - 1));
+    }
+    std::sort(ranks.begin(), ranks.end());
+    m_ranks.assign(1, std::make_shared<const std::vector<Rank>>(std::move(ranks)));
+    m_unranked.clear();
+}
+
+Problem ProblemSet::getRandomProblem(double minDifficulty, double maxDifficulty, std::default_random_engine &randomEngine) const {
+    // the problems in range are a slice of each run
+    std::vector<std::pair<const Rank *, const Rank *>> slices;
+    ptrdiff_t count = 0;
+    for (const auto &run : m_ranks) {
+        const Rank *begin = run->data(), *end = begin + run->size();
+        auto first = std::lower_bound(begin, end, Rank{(float)minDifficulty, 0});
+        auto last = std::upper_bound(first, end, Rank{(float)maxDifficulty, 0});
+        slices.emplace_back(first, last);
+        count += last - first;
+    }
+    if (count == 0) {
+        // nothing in range: take the neighbour nearest to it
+        const Rank *nearest = nullptr;
+        double distance = 0;
+        for (size_t i = 0; i < m_ranks.size(); i++) {
+            const Rank *first = slices[i].first, *begin = m_ranks[i]->data(), *end = begin + m_ranks[i]->size();
+            if (first != end && (!nearest || first->difficulty - maxDifficulty < distance)) {
+                nearest = first;
+                distance = first->difficulty - maxDifficulty;
+            }
+            if (first != begin && (!nearest || minDifficulty - first[-1].difficulty < distance)) {
+                nearest = first - 1;
+                distance = minDifficulty - nearest->difficulty;
+            }
+        }
+        return nearest ? problem(nearest->index) : Problem("");
+    }
+    std::uniform_int_distribution<ptrdiff_t> distrib(0, count - 1);
+    ptrdiff_t pick = distrib(randomEngine);
+    for (const auto &[first, last] : slices) {
+        if (pick < last - first) return problem(first[pick].index);
+        pick -= last - first;
+    }
+    return Problem("");
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "MappedFile.h"
+#include "Problem.h"
+#include "ProblemStats.h"
+#include "WordTrie.h"
+#include <memory>
+#include <random>
+#include <vector>
+
+class ProblemSet;
+using ProblemSetPtr = std::shared_ptr<const ProblemSet>;
+
+// An immutable snapshot once published. Changes are made on a copy which
+// then replaces the published one, so readers never see a half-built index.
+//
+// A copy shares all but the last, partly filled chunk of each store with the
+// set it came from, so publishing a few words does not copy the whole set:
+// - words are lines of the mapped problems.tsv or of fixed-size chunks
+//   holding words added since loading, and a problem is the 4-byte offset of
+//   its line, in chunks too;
+// - the difficulty index is a few sorted runs, merged as WordTrie merges its
+//   graphs.
+class ProblemSet {
+  public:
+    ProblemSet() = default;
+    ProblemSet(const ProblemSet &other);
+
+    static std::shared_ptr<ProblemSet> load(const std::string &path);
+
+    // Adds the problems not in the set yet and returns how many there were;
+    // addedEach, if given, tells which. Words too long for WordTrie or with
+    // a line break in them are left out.
+    int add(const std::vector<Problem> &problems, std::vector<bool> *addedEach = nullptr);
+    bool contains(std::string_view word) const;
+    // up to limit words starting with prefix, in byte order
+    std::vector<std::string> withPrefix(std::string_view prefix, size_t limit) const;
+    // see WordTrie::findWithin
+    std::string findSimilar(std::string_view word, int maxDistance, size_t minLength = 0) const;
+    int size() const { return (int)m_size; }
+    Problem problem(int index) const { return Problem(word(offsetOf(index)), index); }
+
+    // Problems start with their length as difficulty. add() leaves them
+    // out of the index; call updateIndex() before publishing.
+    void updateIndex();
+    void rescore(const ProblemStats &stats);
+
+    // O(log^2 n): picks uniformly among problems whose difficulty is in
+    // [minDifficulty, maxDifficulty], or the closest one if there are none.
+    Problem getRandomProblem(double minDifficulty, double maxDifficulty, std::default_random_engine &randomEngine) const;
+
+  private:
+    static constexpr size_t chunkSize = 16 * 1024;
+    static constexpr size_t offsetChunkSize = 4096;
+
+    // Offsets below the size of the file are in it, the rest in m_chunks,
+    // so the words take up to 4 GB. Every word is followed by '\n', maybe
+    // after '\r'.
+    uint32_t store(std::string_view word);
+    std::string_view word(uint32_t offset) const;
+    uint32_t offsetOf(int index) const { return (*m_offsets[index / offsetChunkSize])[index % offsetChunkSize]; }
+    void append(uint32_t offset);
+
+    MappedFilePtr m_file;
+    std::vector<std::shared_ptr<char[]>> m_chunks;
+    size_t m_chunkUsed = chunkSize;
+
+    struct Rank {
+        float difficulty;
+        int index;
+        bool operator<(const Rank &other) const { return difficulty < other.difficulty; }
+    };
+
+    std::vector<std::shared_ptr<std::vector<uint32_t>>> m_offsets;
+    size_t m_size = 0;
+    std::vector<std::shared_ptr<const std::vector<Rank>>> m_ranks;
+    std::vector<Rank> m_unranked;
+    WordTrie m_words;
+};
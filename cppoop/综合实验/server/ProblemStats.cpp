@@ -0,0 +1,42 @@
+#include "ProblemStats.h"
+
+ProblemStats::~ProblemStats() {
+    for (auto &segment : m_segments) {
+        delete[] segment.load();
+    }
+}
+
+void ProblemStats::record(int index, bool solved, int solveTime) {
+    Counters *c = counters(index);
+    if (c == nullptr) return;
+    c->attempts.fetch_add(1, std::memory_order_relaxed);
+    if (solved) {
+        c->successes.fetch_add(1, std::memory_order_relaxed);
+        c->solveTime.fetch_add(solveTime, std::memory_order_relaxed);
+    }
+}
+
+ProblemStats::Entry ProblemStats::get(int index) const {
+    if (index < 0 || (index >> segmentBits) >= maxSegments) return {0, 0, 0};
+    Counters *segment = m_segments[index >> segmentBits].load(std::memory_order_acquire);
+    if (segment == nullptr) return {0, 0, 0};
+    Counters &c = segment[index & (segmentSize - 1)];
+    return {c.attempts.load(std::memory_order_relaxed),
+            c.successes.load(std::memory_order_relaxed),
+            c.solveTime.load(std::memory_order_relaxed)};
+}
+
+ProblemStats::Counters *ProblemStats::counters(int index) {
+    if (index < 0 || (index >> segmentBits) >= maxSegments) return nullptr;
+    auto &slot = m_segments[index >> segmentBits];
+    Counters *segment = slot.load(std::memory_order_acquire);
+    if (segment == nullptr) {
+        Counters *fresh = new Counters[segmentSize];
+        if (slot.compare_exchange_strong(segment, fresh, std::memory_order_acq_rel)) {
+            segment = fresh;
+        } else {
+            delete[] fresh;
+        }
+    }
+    return &segment[index & (segmentSize - 1)];
+}
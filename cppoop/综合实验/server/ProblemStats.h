@@ -0,0 +1,39 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Per-problem solve counters, indexed by Problem::index(). Counters are
+// updated from the I/O thread and read by the difficulty updater without
+// locking; storage grows in fixed segments so it never moves.
+class ProblemStats {
+  public:
+    struct Entry {
+        uint32_t attempts;
+        uint32_t successes;
+        uint64_t solveTime; // sum over successes, in 0.1s
+    };
+
+    ProblemStats() = default;
+    ~ProblemStats();
+    ProblemStats(const ProblemStats &) = delete;
+    ProblemStats &operator=(const ProblemStats &) = delete;
+
+    void record(int index, bool solved, int solveTime);
+    Entry get(int index) const;
+
+  private:
+    struct Counters {
+        std::atomic<uint32_t> attempts{0};
+        std::atomic<uint32_t> successes{0};
+        std::atomic<uint64_t> solveTime{0};
+    };
+
+    static constexpr int segmentBits = 12;
+    static constexpr int segmentSize = 1 << segmentBits;
+    static constexpr int maxSegments = 4096;
+
+    Counters *counters(int index);
+
+    std::array<std::atomic<Counters *>, maxSegments> m_segments{};
+};
@@ -0,0 +1,143 @@
+#include "Rating.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace {
+
+const double scale = 173.7178;
+const double tau = 0.5;
+const double epsilon = 0.000001;
+const double pi = 3.14159265358979323846;
+
+double g(double phi) {
+    return 1 / std::sqrt(1 + 3 * phi * phi / (pi * pi));
+}
+
+double expectedScore(double mu, double muOpponent, double phiOpponent) {
+    return 1 / (1 + std::exp(-g(phiOpponent) * (mu - muOpponent)));
+}
+
+// new volatility, step 5 of Glickman's "Example of the Glicko-2 system"
+double volatility(double phi, double sigma, double delta, double v) {
+    double a = std::log(sigma * sigma);
+    auto f = [&](double x) {
+        double ex = std::exp(x);
+        double d = phi * phi + v + ex;
+        return ex * (delta * delta - d) / (2 * d * d) - (x - a) / (tau * tau);
+    };
+    double A = a, B;
+    if (delta * delta > phi * phi + v) {
+        B = std::log(delta * delta - phi * phi - v);
+    } else {
+        int k = 1;
+        while (f(a - k * tau) < 0) k++;
+        B = a - k * tau;
+    }
+    double fA = f(A), fB = f(B);
+    while (std::abs(B - A) > epsilon) {
+        double C = A + (A - B) * fA / (fB - fA);
+        double fC = f(C);
+        if (fC * fB <= 0) {
+            A = B;
+            fA = fB;
+        } else {
+            fA /= 2;
+        }
+        B = C;
+        fB = fC;
+    }
+    return std::exp(A / 2);
+}
+
+} // namespace
+
+double Rating::difficultyOffset() const {
+    return std::clamp((rating - 1500) / 200, -2.0, 4.0);
+}
+
+void RatingSystem::start(std::chrono::seconds periodLength, Post post, Apply apply) {
+    m_periodLength = periodLength;
+    m_post = post;
+    m_apply = apply;
+    std::thread([this] {
+        for (;;) {
+            auto now = std::chrono::system_clock::now().time_since_epoch();
+            auto period = now / m_periodLength;
+            std::this_thread::sleep_until(std::chrono::system_clock::time_point((period + 1) * m_periodLength));
+            closePeriod(period);
+        }
+    }).detach();
+}
+
+void RatingSystem::enqueue(const std::string &name1, const Rating &rating1,
+                           const std::string &name2, const Rating &rating2, double score1) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.push_back({name1, name2, rating1, rating2, score1});
+}
+
+Rating RatingSystem::update(const Rating &player, const std::vector<std::pair<Rating, double>> &games, long long period) {
+    double mu = (player.rating - 1500) / scale;
+    double phi = player.deviation / scale;
+    double sigma = player.volatility;
+
+    // periods without games only widen the deviation
+    long long missed = std::max(0LL, period - player.period - 1);
+    phi = std::min(std::sqrt(phi * phi + missed * sigma * sigma), 350 / scale);
+
+    Rating result = player;
+    result.period = period;
+    if (games.empty()) {
+        result.deviation = std::min(std::sqrt(phi * phi + sigma * sigma), 350 / scale) * scale;
+        return result;
+    }
+
+    double vInv = 0, sum = 0;
+    for (const auto &[opponent, score] : games) {
+        double muOpponent = (opponent.rating - 1500) / scale;
+        double phiOpponent = opponent.deviation / scale;
+        double e = expectedScore(mu, muOpponent, phiOpponent);
+        vInv += g(phiOpponent) * g(phiOpponent) * e * (1 - e);
+        sum += g(phiOpponent) * (score - e);
+    }
+    double v = 1 / vInv;
+    double newSigma = volatility(phi, sigma, v * sum, v);
+    double phiStar = std::sqrt(phi * phi + newSigma * newSigma);
+    double newPhi = 1 / std::sqrt(1 / (phiStar * phiStar) + 1 / v);
+    double newMu = mu + newPhi * newPhi * sum;
+
+    result.rating = newMu * scale + 1500;
+    result.deviation = newPhi * scale;
+    result.volatility = newSigma;
+    return result;
+}
+
+void RatingSystem::closePeriod(long long period) {
+    std::vector<Outcome> outcomes;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        outcomes.swap(m_pending);
+    }
+    if (outcomes.empty()) return;
+
+    std::unordered_map<std::string, std::vector<std::pair<Rating, double>>> games;
+    for (const auto &outcome : outcomes) {
+        Rating rating1 = current(outcome.name1, outcome.rating1);
+        Rating rating2 = current(outcome.name2, outcome.rating2);
+        games[outcome.name1].push_back({rating2, outcome.score1});
+        games[outcome.name2].push_back({rating1, 1 - outcome.score1});
+    }
+
+    Results results;
+    for (const auto &[name, playerGames] : games) {
+        results.push_back({name, update(m_ratings[name], playerGames, period)});
+    }
+    for (const auto &[name, rating] : results) {
+        m_ratings[name] = rating;
+    }
+    m_post([apply = m_apply, results = std::move(results)] { apply(results); });
+}
+
+Rating &RatingSystem::current(const std::string &name, const Rating &seen) {
+    return m_ratings.try_emplace(name, seen).first->second;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Glicko-2 rating, on the usual 1500 scale.
+struct Rating {
+    double rating = 1500;
+    double deviation = 350;
+    double volatility = 0.06;
+    long long period = 0; // rating period of the last update
+
+    // how many length units harder than the level's default band to pick
+    // problems for this player
+    double difficultyOffset() const;
+};
+
+// Collects battle outcomes and applies Glicko-2 once per rating period on
+// a background thread. Ratings within a period are computed against the
+// ratings at its start, as the algorithm requires, so the I/O thread only
+// has to enqueue outcomes and later receives the new ratings via post.
+class RatingSystem {
+  public:
+    using Post = std::function<void(std::function<void()>)>;
+    using Results = std::vector<std::pair<std::string, Rating>>;
+    using Apply = std::function<void(const Results &results)>;
+
+    void start(std::chrono::seconds periodLength, Post post, Apply apply);
+
+    // score1 is player 1's share of the battle, from 0 (lost) to 1 (won)
+    void enqueue(const std::string &name1, const Rating &rating1,
+                 const std::string &name2, const Rating &rating2, double score1);
+
+    static Rating update(const Rating &player, const std::vector<std::pair<Rating, double>> &games, long long period);
+
+  private:
+    struct Outcome {
+        std::string name1, name2;
+        Rating rating1, rating2;
+        double score1;
+    };
+
+    void closePeriod(long long period);
+    Rating &current(const std::string &name, const Rating &seen);
+
+    std::chrono::seconds m_periodLength{0};
+    Post m_post;
+    Apply m_apply;
+
+    std::mutex m_mutex;
+    std::vector<Outcome> m_pending;
+
+    // only touched by the rating thread
+    std::unordered_map<std::string, Rating> m_ratings;
+};
@@ -1,309 +1,828 @@
-#include "Session.h"
-#include "Database.h"
-#include <iostream>
-
-using std::string, std::getline, std::cout, std::to_string;
-
-std::unordered_set<std::string> logged;
-
-std::shared_ptr<Session> Session::s_matching;
-
-std::string _;
-
-Session::Session(asio::io_context &ioContext, tcp::socket &&socket)
-    : m_ioContext(ioContext), m_socket(std::move(socket)), m_state(SessionState::init) {
-    std::cout << "Session" << std::endl;
-}
-
-Session::~Session() {
-    if (m_battle != nullptr) {
-        m_battle->end(m_side);
-    }
-    if (m_state == SessionState::matching) {
-        s_matching.reset();
-    }
-    if (m_user) {
-       logged.erase(m_user->getName());
-    }
-    std::cout << "~Session" << std::endl;
-}
-
-void Session::start() {
-    async_read();
-}
-
-void Session::sendProblem() {
-    m_problem = db.getRandomProblem(std::min(m_level, 6), m_level + 4);
-    int totalRound = getTotalRound();
-    int timeLimit = getTimeLimit();
-
-    async_write("problem\n"
-                + m_problem.word() + "\n"
-                + to_string(m_level) + " "
-                + to_string(m_round) + " "
-                + to_string(totalRound) + " "
-                + to_string(timeLimit) + "\n");
-    if (m_round == 1) {
-        m_levelStartTime = std::chrono::steady_clock::now();
-    }
-}
-
-int Session::getTotalRound() {
-    if (m_level < 2) return 1;
-    if (m_level < 4) return 2;
-    if (m_level < 6) return 3;
-    if (m_level < 8) return 4;
-    return 5;
-}
-
-int Session::getTimeLimit() {
-    if (m_level < 5) return 40;
-    else if (m_level < 10) return 30;
-    else if (m_level < 15) return 25;
-    else if (m_level < 20) return 20;
-    return 15;
-}
-
-void Session::handle() {
-    std::cout << m_msg << "\n";
-    if (m_state == SessionState::init) handle_init();
-    else if (m_state == SessionState::challengerLogined) handle_challengerLogined();
-    else if (m_state == SessionState::authorLogined) handle_authorLogined();
-    else if (m_state == SessionState::inGame) handle_inGame();
-    else if (m_state == SessionState::waitForRetry) handle_waitForRetry();
-    else if (m_state == SessionState::matching) handle_matching();
-    else if (m_state == SessionState::battle) {
-        if (!m_battle->handle(m_side, m_msg)) {
-            m_state = SessionState::challengerLogined;
-            m_battle.reset();
-        }
-    }
-    if (db.unsaved()) {
-        db.save();
-    }
-}
-
-void Session::handle_init() {
-    std::istringstream is(m_msg);
-    string type;
-    getline(is, type);
-    if (type == "signup") {
-        std::string name, password;
-        int userTypeId;
-        is >> userTypeId;
-        std::getline(is, _);
-        UserType userType = static_cast<UserType>(userTypeId);
-        getline(is, name);
-        getline(is, password);
-        UserPtr user;
-        if (userType == UserType::challenger) {
-            user = std::make_shared<Challenger>(name, password);
-        } else if (userType == UserType::author) {
-            user = std::make_shared<Author>(name, password);
-        }
-        std::string response;
-        if (user == nullptr) {
-            response = "用户类型无效\n";
-        } else if (db.addUser(user)) {
-            response = "success\n";
-        } else {
-            response = "用户名已存在\n ";
-        }
-        async_write("signup_res\n" + response);
-
-    } else if (type == "login") {
-        string name, password;
-        getline(is, name);
-        getline(is, password);
-        std::string response;
-
-        auto result = db.getUserByName(name);
-        if (result == nullptr) {
-            response = "没有此用户\n";
-        } else if (result->getPassword() == password) {
-            if (logged.count(name)) {
-                response = "已经登陆过了\n";
-            } else {
-                logged.insert(name);
-                response = "success\n";
-                m_user = result;
-                auto userType = result->getType();
-                response += to_string(static_cast<int>(userType)) + "\n";
-                if (userType == UserType::challenger) {
-                    auto challenger = std::static_pointer_cast<Challenger>(result);
-                    response += challenger->getInfo();
-                    m_state = SessionState::challengerLogined;
-                } else if (userType == UserType::author) {
-                    auto author = std::static_pointer_cast<Author>(result);
-                    response += author->getInfo();
-                    m_state = SessionState::authorLogined;
-                }
-            }
-        } else {
-            response = "密码错误\n";
-        }
-        async_write("login_res\n" + response);
-    }
-}
-
-void Session::handle_challengerLogined() {
-    auto challenger = std::static_pointer_cast<Challenger>(m_user);
-    std::istringstream is(m_msg);
-    string type;
-    getline(is, type);
-    if (type == "logout") {
-        logged.erase(m_user->getName());
-        m_state = SessionState::init;
-    } else if (type == "play") {
-        m_level = 1;
-        m_round = 1;
-        m_retry = 2;
-        sendProblem();
-        m_state = SessionState::inGame;
-    } else if (type == "start_match") {
-        if (s_matching == nullptr) {
-            m_side = 1;
-            s_matching = shared_from_this();
-        } else {
-            m_side = 2;
-            m_battle = std::make_shared<Battle>(
-                *std::static_pointer_cast<Challenger>(s_matching->m_user),
-                *std::static_pointer_cast<Challenger>(m_user),
-                std::bind(&Session::async_write, s_matching, std::placeholders::_1),
-                std::bind(&Session::async_write, this, std::placeholders::_1));
-            s_matching->m_battle = m_battle;
-            s_matching = nullptr;
-        }
-        m_state = SessionState::matching;
-    } else if (type == "userlist") {
-        async_write(db.getUserListForClient());
-    }
-}
-
-void Session::handle_authorLogined() {
-    auto author = std::static_pointer_cast<Author>(m_user);
-    std::istringstream is(m_msg);
-    string type;
-    getline(is, type);
-    if (type == "logout") {
-        logged.erase(m_user->getName());
-        m_state = SessionState::init;
-    } else if (type == "make_problem") {
-        string word;
-        getline(is, word);
-        std::string response;
-        if (db.addProblem(Problem(word))) {
-            response = "success\n";
-            author->addProblem();
-        } else {
-            response = "该单词已添加\n";
-        }
-        async_write("make_problem_res\n" + response + author->getInfo());
-    } else if (type == "userlist") {
-        async_write(db.getUserListForClient());
-    }
-}
-
-void Session::handle_inGame() {
-    auto challenger = std::static_pointer_cast<Challenger>(m_user);
-    std::istringstream is(m_msg);
-    string type;
-    getline(is, type);
-    if (type == "exit") {
-        m_state = SessionState::challengerLogined;
-    } else if (type == "submit") {
-        std::string answer;
-        getline(is, answer);
-        if (answer == m_problem.word()) {
-            int duration = 0, expGained = 0;
-            if (m_round < getTotalRound()) {
-                m_round++;
-            } else {
-                auto now = std::chrono::steady_clock::now();
-                duration = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_levelStartTime).count() / 100;
-                int totalRound = getTotalRound();
-                int timeLimit = getTimeLimit();
-                double secondPerRound = ((duration - 5 * (totalRound - 1)) / totalRound - timeLimit) / 10.0;
-                expGained = (1 + m_level) * (4 + 8 / (secondPerRound + 1));
-                m_round = 1;
-                m_level++;
-                challenger->passLevel();
-                challenger->addExp(expGained);
-            }
-            async_write("result\n1\n"
-                        + to_string(duration) + " " + to_string(expGained) + " " + to_string(m_retry) + "\n"
-                        + challenger->getInfo());
-            asio::steady_timer t(m_ioContext, asio::chrono::milliseconds(500));
-            auto self = shared_from_this();
-            t.async_wait([this, self](std::error_code ec) {
-                sendProblem();
-            });
-        } else {
-            async_write("result\n0\n0 0 " + to_string(m_retry) + "\n"
-                        + challenger->getInfo());
-            m_state = SessionState::waitForRetry;
-        }
-    }
-}
-
-void Session::handle_waitForRetry() {
-    auto challenger = std::static_pointer_cast<Challenger>(m_user);
-    std::istringstream is(m_msg);
-    string type;
-    getline(is, type);
-    if (type == "retry") {
-        if (m_retry > 0) {
-            m_retry--;
-            m_round = 1;
-            sendProblem();
-            m_state = SessionState::inGame;
-        }
-    } else if (type == "exit") {
-        m_state = SessionState::challengerLogined;
-    }
-}
-
-void Session::handle_matching() {
-    auto challenger = std::static_pointer_cast<Challenger>(m_user);
-    std::istringstream is(m_msg);
-    string type;
-    getline(is, type);
-    if (type == "stop_match") {
-        s_matching = nullptr;
-        m_state = SessionState::challengerLogined;
-    } else if (type == "poll_match") {
-        if (m_battle) {
-            async_write("match_res\n1\n");
-            m_state = SessionState::battle;
-        } else {
-            async_write("match_res\n0\n");
-        }
-    }
-}
-
-void Session::async_read() {
-    auto self(shared_from_this());
-    asio::async_read_until(m_socket, m_inbuf, '\0',
-                           [this, self](std::error_code ec, std::size_t length) {
-                               if (ec) {
-                                   std::cout << "connection closed: " << ec.message() << std::endl;
-                                   m_socket.close();
-                               } else {
-                                   std::istream inbufStream(&m_inbuf);
-                                   std::getline(inbufStream, m_msg, '\0');
-                                   handle();
-                                   async_read();
-                               }
-                           });
-}
-
-void Session::async_write(const std::string &s) {
-    auto self(shared_from_this());
-    asio::async_write(m_socket, asio::buffer(s.c_str(), s.length() + 1),
-                      [this, self](std::error_code ec, std::size_t length) {
-                          if (ec) {
-                              std::cout << "connection closed: " << ec.message() << std::endl;
-                              m_socket.close();
-                          }
-                      });
-}
\ No newline at end of file
+#include "Session.h"
+#include "Database.h"
+#include "SlabPool.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <unordered_set>
+#ifdef USE_TLS
+#include <openssl/rand.h>
+#endif
+
+using std::string, std::cout, std::to_string;
+
+std::unordered_set<std::string> logged;
+
+std::vector<std::shared_ptr<Session>> Session::s_matchingPool;
+std::unordered_map<std::string, std::weak_ptr<Session>> Session::s_resumable;
+
+const auto parkTime = std::chrono::seconds(60);
+const size_t sentLogSize = 16;
+const size_t maxUserPageSize = 200;
+const size_t maxSearchResults = 20;
+const int maxBatchSize = 100;
+const int maxPrefetch = 3;
+
+// 128 bits from the system's secure generator: a token is all it takes to
+// take over a parked session, so it must not be guessable from earlier ones
+static std::string makeResumeToken() {
+    unsigned char bytes[16];
+#ifdef USE_TLS
+    if (RAND_bytes(bytes, sizeof bytes) != 1)
+#endif
+    {
+        std::random_device device;
+        for (auto &byte : bytes) {
+            byte = (unsigned char)device();
+        }
+    }
+    static const char digits[] = "0123456789abcdef";
+    std::string token;
+    for (unsigned char byte : bytes) {
+        token += digits[byte >> 4];
+        token += digits[byte & 15];
+    }
+    return token;
+}
+
+static std::string describe(const ProblemReview &review) {
+    switch (review.verdict) {
+    case ProblemVerdict::accepted:
+        return "success";
+    case ProblemVerdict::badCharacter:
+        return "单词只能由小写字母组成";
+    case ProblemVerdict::badLength:
+        return "单词长度应为2到30个字母";
+    case ProblemVerdict::unknownWord:
+        return "词典中没有该单词";
+    case ProblemVerdict::duplicate:
+        return "该单词已添加";
+    case ProblemVerdict::similar:
+        return "与已有单词 " + review.conflict + " 过于相近";
+    }
+    return "";
+}
+
+Session::Session(asio::io_context &ioContext, std::unique_ptr<Stream> stream)
+    : m_ioContext(ioContext), m_stream(std::move(stream)), m_state(SessionState::init) {
+    std::cout << "Session" << std::endl;
+}
+
+std::shared_ptr<Session> Session::create(asio::io_context &ioContext, std::unique_ptr<Stream> stream) {
+    return std::allocate_shared<Session>(PoolAllocator<Session>(), ioContext, std::move(stream));
+}
+
+Session::~Session() {
+    release();
+    std::cout << "~Session" << std::endl;
+}
+
+void Session::release() {
+    m_throttleTimer.cancel();
+    if (!m_resumeToken.empty()) {
+        s_resumable.erase(m_resumeToken);
+        m_resumeToken.clear();
+    }
+    if (m_battle != nullptr) {
+        m_battle->end(m_side);
+        m_battle.reset();
+    }
+    if (m_user) {
+        logged.erase(m_user->getName());
+        m_user.reset();
+    }
+}
+
+void Session::start() {
+    auto self(shared_from_this());
+    m_stream->async_handshake([this, self](std::error_code ec) {
+        if (ec) {
+            std::cout << "handshake failed: " << ec.message() << std::endl;
+            close();
+        } else {
+            async_read();
+        }
+    });
+}
+
+Problem Session::pickProblem(int level) {
+    double offset = std::static_pointer_cast<Challenger>(m_user)->getRating().difficultyOffset();
+    return db.getRandomProblem(m_problemSet, std::min(level, 6) + offset, level + 4 + offset);
+}
+
+void Session::writeProblem(const std::string &type, const Problem &problem, int level, int round) {
+    async_write(type + "\n"
+                + std::string(problem.word()) + "\n"
+                + to_string(level) + " "
+                + to_string(round) + " "
+                + to_string(getTotalRound(level)) + " "
+                + to_string(getTimeLimit(level)) + "\n");
+}
+
+void Session::sendProblem() {
+    sendProblem(pickProblem(m_level));
+}
+
+void Session::sendProblem(const Problem &problem) {
+    m_problem = problem;
+    writeProblem("problem", m_problem, m_level, m_round);
+    startProblem(std::chrono::steady_clock::now());
+    m_upcoming.clear();
+    sendUpcoming();
+}
+
+void Session::startProblem(std::chrono::steady_clock::time_point startTime) {
+    m_problemStartTime = startTime;
+    if (m_round == 1) {
+        m_levelStartTime = m_problemStartTime;
+    }
+}
+
+void Session::checkpointGame(bool problemShown) {
+    // the rounds before this one, which the level's time is counted over
+    int levelTime = 0;
+    if (m_round > 1) {
+        auto elapsed = std::chrono::steady_clock::now() - m_levelStartTime;
+        levelTime = (int)(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() / 100);
+    }
+    std::string word = problemShown ? std::string(m_problem.word()) : "";
+    db.checkpointGame(m_user->getName(), {m_level, m_round, m_retry, levelTime, word});
+}
+
+// tops up the problems the client holds for the rounds after this one
+void Session::sendUpcoming() {
+    int level = m_level, round = m_round;
+    if (!m_upcoming.empty()) {
+        level = m_upcoming.back().level;
+        round = m_upcoming.back().round;
+    }
+    while ((int)m_upcoming.size() < m_prefetch) {
+        if (round < getTotalRound(level)) {
+            round++;
+        } else {
+            level++;
+            round = 1;
+        }
+        m_upcoming.push_back({pickProblem(level), level, round});
+        writeProblem("next_problem", m_upcoming.back().problem, level, round);
+    }
+}
+
+int Session::getTotalRound(int level) {
+    if (level < 2) return 1;
+    if (level < 4) return 2;
+    if (level < 6) return 3;
+    if (level < 8) return 4;
+    return 5;
+}
+
+int Session::getTimeLimit(int level) {
+    if (level < 5) return 40;
+    else if (level < 10) return 30;
+    else if (level < 15) return 25;
+    else if (level < 20) return 20;
+    return 15;
+}
+
+void Session::handle() {
+    std::cout << m_msg << "\n";
+    m_received++;
+    if (m_msg.rfind("set_compression\n", 0) == 0) {
+#ifdef USE_ZLIB
+        if (m_msg == "set_compression\n1\n") m_compressor = std::make_unique<MessageCompressor>();
+        else m_compressor.reset();
+#endif
+        return;
+    }
+    if (m_state == SessionState::init) handle_init();
+    else if (m_state == SessionState::challengerLogined) handle_challengerLogined();
+    else if (m_state == SessionState::authorLogined) handle_authorLogined();
+    else if (m_state == SessionState::inGame) handle_inGame();
+    else if (m_state == SessionState::waitForRetry) handle_waitForRetry();
+    else if (m_state == SessionState::matching) handle_matching();
+    else if (m_state == SessionState::battle) {
+        if (!m_battle->handle(m_side, m_msg)) {
+            m_state = SessionState::challengerLogined;
+            m_battle.reset();
+        }
+    }
+    if (db.unsaved()) {
+        db.save();
+    }
+}
+
+void Session::handle_init() {
+    MessageReader is(m_msg);
+    std::string_view type = is.line();
+    if (type == "signup") {
+        int userTypeId = 0;
+        is >> userTypeId;
+        is.line();
+        std::string name(is.line()), password(is.line());
+        UserPtr user;
+        if (userTypeId == (int)UserType::challenger) {
+            user = std::make_shared<Challenger>(name, password);
+        } else if (userTypeId == (int)UserType::author) {
+            user = std::make_shared<Author>(name, password);
+        }
+        std::string response;
+        if (user == nullptr) {
+            response = "用户类型无效\n";
+        } else if (name.empty() || name.find('\t') != string::npos || password.find('\t') != string::npos) {
+            // users.tsv could not be read back
+            response = "用户名不能为空，用户名和密码不能含制表符\n";
+        } else if (db.addUser(user)) {
+            response = "success\n";
+        } else {
+            response = "用户名已存在\n ";
+        }
+        async_write("signup_res\n" + response);
+
+    } else if (type == "login") {
+        std::string name(is.line()), password(is.line());
+        std::string response;
+
+        auto result = db.getUserByName(name);
+        if (result != nullptr && result->getPassword() == password) {
+            expireParked(name);
+        }
+        if (result == nullptr) {
+            response = "没有此用户\n";
+        } else if (result->getPassword() == password) {
+            if (logged.count(name)) {
+                response = "已经登陆过了\n";
+            } else {
+                logged.insert(name);
+                response = "success\n";
+                m_user = result;
+                auto userType = result->getType();
+                response += to_string(static_cast<int>(userType)) + "\n";
+                if (userType == UserType::challenger) {
+                    auto challenger = std::static_pointer_cast<Challenger>(result);
+                    response += challenger->getInfo();
+                    m_state = SessionState::challengerLogined;
+                } else if (userType == UserType::author) {
+                    auto author = std::static_pointer_cast<Author>(result);
+                    response += author->getInfo();
+                    m_state = SessionState::authorLogined;
+                }
+                m_resumeToken = makeResumeToken();
+                s_resumable[m_resumeToken] = weak_from_this();
+                response += "\n" + m_resumeToken + "\n";
+            }
+        } else {
+            response = "密码错误\n";
+        }
+        async_write("login_res\n" + response);
+    } else if (type == "resume") {
+        std::string token(is.line());
+        unsigned long long clientReceived = 0;
+        is >> clientReceived;
+        std::shared_ptr<Session> session;
+        auto it = s_resumable.find(token);
+        if (it != s_resumable.end()) session = it->second.lock();
+        if (session == nullptr || session->m_sent < clientReceived
+            || session->m_sent - clientReceived > session->m_sentLog.size()) {
+            async_write("resume_res\n会话已失效\n");
+        } else {
+            // the old connection may not have been noticed as dead yet
+            session->attach(std::move(m_stream), m_inbuf, clientReceived);
+        }
+    }
+}
+
+void Session::sendUserPage(MessageReader &is) {
+    UserQuery query;
+    int type = 0;
+    size_t offset = 0, count = 0;
+    is >> type >> query.sortBy >> query.ascending >> query.filterBy;
+    is.ignore(1);
+    query.filterText = is.line();
+    is >> offset >> count;
+    if (!is || (type != 1 && type != 2)) return;
+    query.type = UserType(type);
+    // the first page of a view sorts anew, later ones page through that order
+    if (offset == 0 || !(query == m_userQuery)) {
+        m_userQuery = query;
+        m_userView = db.queryUsers(query);
+    }
+    async_write(db.getUserPageForClient(m_userView, offset, std::min<size_t>(count, maxUserPageSize)));
+}
+
+void Session::handle_challengerLogined() {
+    auto challenger = std::static_pointer_cast<Challenger>(m_user);
+    MessageReader is(m_msg);
+    std::string_view type = is.line();
+    if (type == "logout") {
+        release();
+        m_state = SessionState::init;
+    } else if (type == "play") {
+        int resume = 0;
+        m_prefetch = 0;
+        is >> m_prefetch >> resume;
+        m_prefetch = std::clamp(m_prefetch, 0, maxPrefetch);
+        GameState game;
+        if (resume == 1) {
+            auto saved = db.getSavedGame(challenger->getName());
+            if (saved && saved->round <= getTotalRound(saved->level)) game = *saved;
+        }
+        m_level = game.level;
+        m_round = game.round;
+        m_retry = game.retry;
+        m_problemSet = db.getProblemSet();
+        // a round already shown goes on with the same word, so dropping the
+        // connection does not give a new pick for free
+        m_resumedWord = game.word;
+        if (m_resumedWord.empty()) {
+            sendProblem();
+        } else {
+            sendProblem(Problem(m_resumedWord));
+        }
+        m_levelStartTime = std::chrono::steady_clock::now() - std::chrono::milliseconds(100) * game.levelTime;
+        checkpointGame();
+        m_state = SessionState::inGame;
+    } else if (type == "start_match") {
+        m_matchStartTime = std::chrono::steady_clock::now();
+        s_matchingPool.push_back(shared_from_this());
+        m_state = SessionState::matching;
+        tryMatch();
+    } else if (type == "tournament_join") {
+        int id = 0;
+        is >> id;
+        auto tournament = tournaments.get(id);
+        if (tournament == nullptr) {
+            async_write("tournament_join_res\n没有该比赛\n");
+        } else if (tournament->getState() != TournamentState::open) {
+            async_write("tournament_join_res\n报名已截止\n");
+        } else if (!tournament->join(m_user->getName())) {
+            async_write("tournament_join_res\n已经报名\n");
+        } else {
+            tournaments.save();
+            async_write("tournament_join_res\nsuccess\n");
+        }
+    } else if (type == "tournament_play") {
+        int id = 0;
+        is >> id;
+        auto tournament = tournaments.get(id);
+        string opponent = tournament ? tournament->opponentOf(m_user->getName()) : "";
+        if (opponent.empty()) {
+            async_write("tournament_play_res\n当前没有你的比赛\n");
+        } else {
+            tournament->checkIn(m_user->getName());
+            async_write("tournament_play_res\nsuccess\n" + opponent + "\n");
+            m_tournament = id;
+            m_matchStartTime = std::chrono::steady_clock::now();
+            s_matchingPool.push_back(shared_from_this());
+            m_state = SessionState::matching;
+            tryMatch();
+        }
+    } else if (type == "tournament_list" || type == "tournament_info") {
+        sendTournaments(type, is);
+    } else if (type == "userlist") {
+        async_write(db.getUserListForClient());
+    } else if (type == "userlist_page") {
+        sendUserPage(is);
+    }
+}
+
+void Session::handle_authorLogined() {
+    auto author = std::static_pointer_cast<Author>(m_user);
+    MessageReader is(m_msg);
+    std::string_view type = is.line();
+    if (type == "logout") {
+        release();
+        m_state = SessionState::init;
+    } else if (type == "make_problem") {
+        makeProblems({std::string(is.line())}, false);
+    } else if (type == "tournament_create") {
+        int seedBy = 0;
+        is >> seedBy;
+        is.line();
+        std::string title(is.line());
+        if (title.empty() || title.find_first_of("\t\r") != string::npos) {
+            // tournaments.tsv could not be read back
+            async_write("tournament_create_res\n名称不能为空，不能含制表符\n");
+        } else {
+            auto tournament = tournaments.create(title, seedBy == 1 ? 1 : 0);
+            tournaments.save();
+            async_write("tournament_create_res\nsuccess\n" + to_string(tournament->getId()) + "\n");
+        }
+    } else if (type == "tournament_start") {
+        int id = 0;
+        is >> id;
+        auto tournament = tournaments.get(id);
+        auto seedBy = tournament ? tournament->getSeedBy() : 0;
+        auto seedKey = [seedBy](const string &name) -> double {
+            auto user = db.getUserByName(name);
+            if (user == nullptr || user->getType() != UserType::challenger) return 0;
+            auto challenger = std::static_pointer_cast<Challenger>(user);
+            return seedBy == 1 ? challenger->getLevel() : challenger->getRating().rating;
+        };
+        if (tournament == nullptr) {
+            async_write("tournament_start_res\n没有该比赛\n");
+        } else if (!tournament->start(seedKey)) {
+            async_write("tournament_start_res\n比赛已开始或报名人数不足\n");
+        } else {
+            tournaments.roundStarted(*tournament);
+            tournaments.save();
+            async_write("tournament_start_res\nsuccess\n");
+        }
+    } else if (type == "tournament_list" || type == "tournament_info") {
+        sendTournaments(type, is);
+    } else if (type == "make_problems") {
+        int n = 0;
+        is >> n;
+        is.line();
+        if (m_reviewing) {
+            async_write("make_problems_res\n上一批单词仍在审核中\n0\n" + author->getInfo());
+        } else if (n <= 0 || n > maxBatchSize) {
+            async_write("make_problems_res\n每批应有1到" + to_string(maxBatchSize) + "个单词\n0\n" + author->getInfo());
+        } else {
+            std::vector<std::string> words(n);
+            for (auto &word : words) {
+                word = is.line();
+            }
+            m_reviewing = true;
+            makeProblems(std::move(words), true);
+        }
+    } else if (type == "search_problems") {
+        auto words = db.getProblemsWithPrefix(std::string(is.line()), maxSearchResults);
+        string response = "search_problems_res\n" + to_string(words.size()) + "\n";
+        for (const auto &word : words) {
+            response += word + "\n";
+        }
+        async_write(response);
+    } else if (type == "import_problems") {
+        std::string name(is.line());
+        auto self = shared_from_this();
+        db.importProblems(name, [this, self](int imported, int total) {
+            asio::post(m_ioContext, [this, self, imported, total] {
+                if (imported < 0) {
+                    async_write("import_problems_res\n无法打开imports目录下的该文件\n0 " + to_string(total) + "\n");
+                } else {
+                    async_write("import_problems_res\nsuccess\n" + to_string(imported) + " " + to_string(total) + "\n");
+                }
+            });
+        });
+    } else if (type == "userlist") {
+        async_write(db.getUserListForClient());
+    } else if (type == "userlist_page") {
+        sendUserPage(is);
+    }
+}
+
+// The words are reviewed and problems.tsv written on the database's review
+// thread. The author is credited back on the I/O thread and saved once per
+// batch.
+void Session::makeProblems(std::vector<std::string> words, bool batch) {
+    auto author = std::static_pointer_cast<Author>(m_user);
+    auto self = shared_from_this();
+    db.addProblems(std::move(words), [this, self, author, batch](std::vector<ProblemReview> reviews) {
+        asio::post(m_ioContext, [this, self, author, batch, reviews = std::move(reviews)] {
+            for (const auto &review : reviews) {
+                if (review.verdict == ProblemVerdict::accepted) {
+                    author->addProblem();
+                }
+            }
+            if (batch) {
+                m_reviewing = false;
+                string response = "make_problems_res\nsuccess\n" + to_string(reviews.size()) + "\n";
+                for (const auto &review : reviews) {
+                    response += describe(review) + "\n";
+                }
+                async_write(response + author->getInfo());
+            } else {
+                async_write("make_problem_res\n" + describe(reviews.front()) + "\n" + author->getInfo());
+            }
+            if (db.unsaved()) {
+                db.save();
+            }
+        });
+    });
+}
+
+void Session::handle_inGame() {
+    auto challenger = std::static_pointer_cast<Challenger>(m_user);
+    MessageReader is(m_msg);
+    std::string_view type = is.line();
+    if (type == "exit") {
+        m_throttleTimer.cancel();
+        m_upcoming.clear();
+        db.clearGame(challenger->getName());
+        m_state = SessionState::challengerLogined;
+    } else if (type == "submit") {
+        auto solveTime = std::chrono::steady_clock::now() - m_problemStartTime;
+        auto solveTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(solveTime).count();
+        // A prefetched problem answered before it was due to be shown was not
+        // waited for as told, so the delay would mean nothing: it counts as
+        // wrong, and not as an attempt at the word.
+        bool early = solveTimeMs < 0;
+        bool solved = !early && is.line() == m_problem.word();
+        if (!early) {
+            db.recordAttempt(m_problem, solved, solveTimeMs / 100);
+            m_submitAnalyzer.record(solveTimeMs - getTimeLimit(m_level) * 100, m_problem.length());
+        }
+        if (solved && m_submitAnalyzer.suspicious() && m_prefetch > 0) {
+            // the client would show a problem sent ahead without waiting for
+            // the server, so go back to sending each one after the delay
+            m_prefetch = 0;
+            m_upcoming.clear();
+        }
+        if (solved) {
+            int duration = 0, expGained = 0;
+            if (m_round < getTotalRound(m_level)) {
+                m_round++;
+            } else {
+                auto now = std::chrono::steady_clock::now();
+                duration = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_levelStartTime).count() / 100;
+                int totalRound = getTotalRound(m_level);
+                int timeLimit = getTimeLimit(m_level);
+                double secondPerRound = ((duration - 5 * (totalRound - 1)) / totalRound - timeLimit) / 10.0;
+                expGained = (1 + m_level) * (4 + 8 / (secondPerRound + 1));
+                m_round = 1;
+                m_level++;
+                challenger->passLevel();
+                challenger->addExp(expGained);
+            }
+            auto delay = m_submitAnalyzer.suspicious() ? std::chrono::milliseconds(3000) : std::chrono::milliseconds(500);
+            std::string result = "result\n1\n"
+                               + to_string(duration) + " " + to_string(expGained) + " " + to_string(m_retry) + "\n"
+                               + challenger->getInfo();
+            if (!m_upcoming.empty()) {
+                // the client already has the next problem and shows it after
+                // the delay, which is when its time starts
+                result += to_string(delay.count() / 100) + "\n";
+                async_write(result);
+                m_problem = m_upcoming.front().problem;
+                m_upcoming.pop_front();
+                startProblem(std::chrono::steady_clock::now() + delay);
+                checkpointGame();
+                sendUpcoming();
+            } else {
+                async_write(result);
+                checkpointGame(false);
+                auto self = shared_from_this();
+                m_throttleTimer.expires_after(delay);
+                m_throttleTimer.async_wait([this, self](std::error_code ec) {
+                    // a cancel comes too late once the wait has completed
+                    if (!ec && m_user && m_state == SessionState::inGame) {
+                        sendProblem();
+                        checkpointGame();
+                    }
+                });
+            }
+        } else {
+            async_write("result\n0\n0 0 " + to_string(m_retry) + "\n"
+                        + challenger->getInfo());
+            m_upcoming.clear();
+            // going on later counts as taking the retry
+            if (m_retry > 0) {
+                db.checkpointGame(challenger->getName(), {m_level, 1, m_retry - 1, 0});
+            } else {
+                db.clearGame(challenger->getName());
+            }
+            m_state = SessionState::waitForRetry;
+        }
+    }
+}
+
+void Session::handle_waitForRetry() {
+    auto challenger = std::static_pointer_cast<Challenger>(m_user);
+    MessageReader is(m_msg);
+    std::string_view type = is.line();
+    if (type == "retry") {
+        if (m_retry > 0) {
+            m_retry--;
+            m_round = 1;
+            sendProblem();
+            checkpointGame();
+            m_state = SessionState::inGame;
+        }
+    } else if (type == "exit") {
+        m_upcoming.clear();
+        db.clearGame(challenger->getName());
+        m_state = SessionState::challengerLogined;
+    }
+}
+
+void Session::handle_matching() {
+    auto challenger = std::static_pointer_cast<Challenger>(m_user);
+    MessageReader is(m_msg);
+    std::string_view type = is.line();
+    if (type == "stop_match") {
+        leaveMatching();
+        m_tournament = 0;
+        m_state = SessionState::challengerLogined;
+    } else if (type == "poll_match") {
+        tryMatch();
+        if (m_battle) {
+            async_write("match_res\n1\n");
+            m_state = SessionState::battle;
+        } else {
+            async_write("match_res\n0\n");
+        }
+    }
+}
+
+void Session::sendTournaments(std::string_view type, MessageReader &is) {
+    if (type == "tournament_list") {
+        async_write(tournaments.getListForClient());
+    } else if (type == "tournament_info") {
+        int id = 0;
+        is >> id;
+        auto tournament = tournaments.get(id);
+        if (tournament == nullptr) {
+            async_write("tournament_info_res\n没有该比赛\n");
+        } else {
+            async_write("tournament_info_res\nsuccess\n" + tournament->getTitle() + "\n" + tournament->getInfo());
+        }
+    }
+}
+
+// Pairs this session with the waiting player closest in rating. The
+// accepted rating gap widens the longer this player has been waiting.
+// For a tournament match only the bracket's opponent will do, and the
+// result goes back to the tournament when the battle ends.
+void Session::tryMatch() {
+    if (m_battle) return;
+    string opponent;
+    Tournament *tournament = nullptr;
+    if (m_tournament) {
+        tournament = tournaments.get(m_tournament);
+        if (tournament) opponent = tournament->opponentOf(m_user->getName());
+        // decided without it, e.g. when the round closed
+        if (opponent.empty()) return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    double waited = std::chrono::duration<double>(now - m_matchStartTime).count();
+    double window = 100 + 50 * waited;
+    double rating = std::static_pointer_cast<Challenger>(m_user)->getRating().rating;
+    std::shared_ptr<Session> best;
+    for (const auto &other : s_matchingPool) {
+        if (other.get() == this || other->m_battle || other->m_tournament != m_tournament) continue;
+        if (tournament) {
+            if (other->m_user->getName() == opponent) best = other;
+            continue;
+        }
+        // flagged sessions are only ever matched with each other
+        if (other->m_submitAnalyzer.suspicious() != m_submitAnalyzer.suspicious()) continue;
+        double gap = std::abs(std::static_pointer_cast<Challenger>(other->m_user)->getRating().rating - rating);
+        if (gap <= window && (best == nullptr || gap < std::abs(std::static_pointer_cast<Challenger>(best->m_user)->getRating().rating - rating))) {
+            best = other;
+        }
+    }
+    if (best == nullptr) return;
+
+    best->m_side = 1;
+    m_side = 2;
+    m_battle = std::make_shared<Battle>(
+        *std::static_pointer_cast<Challenger>(best->m_user),
+        *std::static_pointer_cast<Challenger>(m_user),
+        std::bind(&Session::async_write, best, std::placeholders::_1),
+        std::bind(&Session::async_write, this, std::placeholders::_1));
+    best->m_battle = m_battle;
+    best->leaveMatching();
+    leaveMatching();
+    if (tournament) {
+        tournament->beginMatch(m_user->getName());
+        m_battle->onEnd([id = m_tournament, name1 = best->m_user->getName(), name2 = m_user->getName()](int winner) {
+            tournaments.report(id, name1, name2, winner);
+        });
+        best->m_tournament = 0;
+        m_tournament = 0;
+    }
+}
+
+void Session::leaveMatching() {
+    auto it = std::find(s_matchingPool.begin(), s_matchingPool.end(), shared_from_this());
+    if (it != s_matchingPool.end()) {
+        s_matchingPool.erase(it);
+    }
+}
+
+void Session::async_read() {
+    auto self(shared_from_this());
+    int generation = m_generation;
+    m_stream->async_read_until(m_inbuf, '\0',
+                               [this, self, generation, stream = m_stream](std::error_code ec, std::size_t length) {
+                                   if (generation != m_generation) return;
+                                   if (ec) {
+                                       std::cout << "connection closed: " << ec.message() << std::endl;
+                                       close();
+                                       if (m_user && !m_resumeToken.empty()) {
+                                           park();
+                                       } else {
+                                           leaveMatching();
+                                       }
+                                   } else {
+                                       // consumed first so a resume does not hand this
+                                       // message on with the stream; the bytes stay in
+                                       // place until the buffer is next written to
+                                       m_msg = std::string_view(static_cast<const char *>(m_inbuf.data().data()), length - 1);
+                                       m_inbuf.consume(length);
+                                       handle();
+                                       // a resume hands the stream over to the parked session
+                                       if (m_stream) async_read();
+                                   }
+                               });
+}
+
+void Session::async_write(const std::string &s) {
+    m_sent++;
+    m_sentLog.push_back(s);
+    if (m_sentLog.size() > sentLogSize) {
+        m_sentLog.pop_front();
+    }
+    m_writeQueue.push_back(s);
+    if (!m_writing && !m_detached) {
+        write_next();
+    }
+}
+
+void Session::write_next() {
+    auto self(shared_from_this());
+    int generation = m_generation;
+    std::string &front = m_writeQueue.front();
+#ifdef USE_ZLIB
+    if (m_compressor && (front.rfind("userlist_res\n", 0) == 0 || front.rfind("userlist_page_res\n", 0) == 0)) {
+        front = m_compressor->compress(front);
+    }
+#endif
+    // attach() replaces the queue under a write it aborts, which may still
+    // read the message
+    auto s = std::make_shared<std::string>(front);
+    m_writing = true;
+    m_stream->async_write(asio::buffer(s->c_str(), s->length() + 1),
+                          [this, self, generation, s, stream = m_stream](std::error_code ec, std::size_t length) {
+                              if (generation != m_generation) return;
+                              m_writing = false;
+                              if (ec) {
+                                  // the read side notices too and parks or ends the session
+                                  std::cout << "connection closed: " << ec.message() << std::endl;
+                                  close();
+                                  return;
+                              }
+                              m_writeQueue.pop_front();
+                              if (!m_writeQueue.empty()) {
+                                  write_next();
+                              }
+                          });
+}
+
+void Session::close() {
+    m_stream->close();
+}
+
+void Session::park() {
+    std::cout << "parked " << m_user->getName() << std::endl;
+    m_detached = true;
+    // the pending wait keeps the session alive
+    auto self(shared_from_this());
+    m_parkTimer.expires_after(parkTime);
+    m_parkTimer.async_wait([this, self](std::error_code ec) {
+        if (!ec) expire();
+    });
+}
+
+void Session::attach(std::shared_ptr<Stream> stream, asio::streambuf &inbuf, unsigned long long clientReceived) {
+    std::cout << "resumed " << m_user->getName() << std::endl;
+    m_parkTimer.cancel();
+    // the old stream's pending operations are aborted, their handlers keep
+    // it until they have run and are ignored
+    if (!m_detached) close();
+    m_stream = std::move(stream);
+    m_generation++;
+    m_detached = false;
+    m_writing = false;
+#ifdef USE_ZLIB
+    // the client starts a new decompressor on every connection
+    m_compressor.reset();
+#endif
+    m_inbuf.consume(m_inbuf.size());
+    std::ostream(&m_inbuf) << &inbuf;
+
+    // messages queued while parked are among the replayed ones
+    m_writeQueue.assign(m_sentLog.end() - (m_sent - clientReceived), m_sentLog.end());
+    m_writeQueue.push_front("resume_res\nsuccess\n" + to_string(m_received) + "\n");
+    write_next();
+    async_read();
+}
+
+void Session::expire() {
+    std::cout << "expired " << m_user->getName() << std::endl;
+    auto self(shared_from_this());
+    m_parkTimer.cancel();
+    leaveMatching();
+    release();
+}
+
+void Session::expireParked(const std::string &name) {
+    for (const auto &[token, weak] : s_resumable) {
+        auto session = weak.lock();
+        if (session && session->m_detached && session->m_user->getName() == name) {
+            session->expire();
+            return;
+        }
+    }
+}
@@ -1,56 +1,143 @@
-#pragma once
-#include "Problem.h"
-#include "User.h"
-#include "asio.hpp"
-#include <memory>
-#include "Battle.h"
-
-using asio::ip::tcp;
-
-enum class SessionState {
-    init,
-    challengerLogined,
-    authorLogined,
-    inGame,
-    waitForRetry,
-    matching,
-    battle
-};
-
-class Session : public std::enable_shared_from_this<Session> {
-  public:
-    Session::Session(asio::io_context &ioContext, tcp::socket &&socket);
-    ~Session();
-    void start();
-
-  private:
-    void sendProblem();
-    int getTotalRound();
-    int getTimeLimit();
-
-    void handle();
-    void handle_init();
-    void handle_challengerLogined();
-    void handle_authorLogined();
-    void handle_inGame();
-    void handle_waitForRetry();
-    void handle_matching();
-
-    void async_read();
-    void async_write(const std::string &s);
-
-    asio::io_context &m_ioContext;
-    tcp::socket m_socket;
-    asio::streambuf m_inbuf, m_outbuf;
-    std::string m_msg;
-    SessionState m_state;
-    UserPtr m_user;
-
-    int m_level, m_round, m_retry;
-    std::chrono::steady_clock::time_point m_levelStartTime;
-    Problem m_problem{""};
-
-    static std::shared_ptr<Session> s_matching;
-    std::shared_ptr<Battle> m_battle;
-    int m_side;
+#pragma once
+#include "MessageReader.h"
+#include "Problem.h"
+#include "Stream.h"
+#include "User.h"
+#include "asio.hpp"
+#include <deque>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Battle.h"
+#include "Database.h"
+#include "SubmitAnalyzer.h"
+#include "Tournament.h"
+#ifdef USE_ZLIB
+#include "Compression.h"
+#endif
+
+using asio::ip::tcp;
+
+enum class SessionState {
+    init,
+    challengerLogined,
+    authorLogined,
+    inGame,
+    waitForRetry,
+    matching,
+    battle
+};
+
+class Session : public std::enable_shared_from_this<Session> {
+  public:
+    Session(asio::io_context &ioContext, std::unique_ptr<Stream> stream);
+    // from a pool of blocks the size of a session, reused across connections
+    static std::shared_ptr<Session> create(asio::io_context &ioContext, std::unique_ptr<Stream> stream);
+    ~Session();
+    void start();
+
+  private:
+    // login ends a parked session of the same user
+    static void expireParked(const std::string &name);
+
+    Problem pickProblem(int level);
+    void writeProblem(const std::string &type, const Problem &problem, int level, int round);
+    void sendProblem();
+    void sendProblem(const Problem &problem);
+    void startProblem(std::chrono::steady_clock::time_point startTime);
+    void sendUpcoming();
+    // saves the game to go on from the start of the current round, with the
+    // same problem if it has been shown
+    void checkpointGame(bool problemShown = true);
+    void tryMatch();
+    void leaveMatching();
+    static int getTotalRound(int level);
+    static int getTimeLimit(int level);
+    void sendUserPage(MessageReader &is);
+    // tournament_list and tournament_info, for either kind of user
+    void sendTournaments(std::string_view type, MessageReader &is);
+    void makeProblems(std::vector<std::string> words, bool batch);
+
+    void handle();
+    void handle_init();
+    void handle_challengerLogined();
+    void handle_authorLogined();
+    void handle_inGame();
+    void handle_waitForRetry();
+    void handle_matching();
+
+    void async_read();
+    void async_write(const std::string &s);
+    void write_next();
+    void close();
+
+    void park();
+    void attach(std::shared_ptr<Stream> stream, asio::streambuf &inbuf, unsigned long long clientReceived);
+    void expire();
+    void release();
+
+    asio::io_context &m_ioContext;
+    // Each handler holds the stream it was started on: a stream closed or
+    // replaced by attach() is still used by its aborted operations until
+    // their handlers have run.
+    std::shared_ptr<Stream> m_stream;
+    asio::streambuf m_inbuf;
+    // one write in flight at a time, which TLS streams require
+    std::deque<std::string> m_writeQueue;
+    bool m_writing = false;
+    // handlers of a stream replaced by attach() are ignored
+    int m_generation = 0;
+    // the message being handled, still in m_inbuf until the next read
+    std::string_view m_msg;
+#ifdef USE_ZLIB
+    std::unique_ptr<MessageCompressor> m_compressor;
+#endif
+    SessionState m_state;
+    UserPtr m_user;
+
+    int m_level, m_round, m_retry;
+    std::chrono::steady_clock::time_point m_levelStartTime, m_problemStartTime;
+    // holds the word of a resumed round, which may not be in m_problemSet
+    std::string m_resumedWord;
+    Problem m_problem{""};
+    ProblemSetPtr m_problemSet;
+    SubmitAnalyzer m_submitAnalyzer;
+    asio::steady_timer m_throttleTimer{m_ioContext};
+
+    // Problems already sent to the client for the rounds that follow if it
+    // keeps answering correctly, so it can show them without a round trip.
+    struct Upcoming {
+        Problem problem;
+        int level, round;
+    };
+    std::deque<Upcoming> m_upcoming;
+    int m_prefetch = 0;
+
+    static std::vector<std::shared_ptr<Session>> s_matchingPool;
+    std::chrono::steady_clock::time_point m_matchStartTime;
+    std::shared_ptr<Battle> m_battle;
+    int m_side;
+    // while matching for a tournament match, only its opponent is taken
+    int m_tournament = 0;
+
+    // the leaderboard view the client is paging through
+    UserQuery m_userQuery;
+    std::vector<UserPtr> m_userView;
+
+    // a make_problems batch is being reviewed, the author waits for it
+    // before sending another
+    bool m_reviewing = false;
+
+    // A logged in session whose connection drops is parked for a grace
+    // period instead of being destroyed, and a new connection presenting
+    // its resume token takes it over. Messages are counted both ways, and
+    // the last few sent are kept so the ones the client missed can be
+    // replayed when it resumes.
+    static std::unordered_map<std::string, std::weak_ptr<Session>> s_resumable;
+    std::string m_resumeToken;
+    bool m_detached = false;
+    asio::steady_timer m_parkTimer{m_ioContext};
+    unsigned long long m_received = 0, m_sent = 0;
+    std::deque<std::string> m_sentLog;
 };
\ No newline at end of file
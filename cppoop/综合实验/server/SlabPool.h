@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Blocks of one size, carved out of slabs of slabSize blocks and kept on a
+// free list when released, so objects that come and go, like sessions, reuse
+// the memory of the ones before. Slabs are never given back.
+template <size_t blockSize, size_t blockAlign> class SlabPool {
+  public:
+    static SlabPool &instance() {
+        // never destroyed, blocks may be released during static destruction
+        static SlabPool *pool = new SlabPool;
+        return *pool;
+    }
+
+    void *allocate() {
+        std::lock_guard lock(m_mutex);
+        if (m_free == nullptr) grow();
+        FreeBlock *block = m_free;
+        m_free = block->next;
+        return block;
+    }
+
+    void release(void *p) {
+        std::lock_guard lock(m_mutex);
+        m_free = new (p) FreeBlock{m_free};
+    }
+
+  private:
+    static constexpr size_t slabSize = 32;
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+    static constexpr size_t align = blockAlign > alignof(FreeBlock) ? blockAlign : alignof(FreeBlock);
+    static constexpr size_t stride = ((blockSize > sizeof(FreeBlock) ? blockSize : sizeof(FreeBlock)) + align - 1) & ~(align - 1);
+
+    void grow() {
+        auto slab = static_cast<char *>(::operator new(stride * slabSize, std::align_val_t(align)));
+        m_slabs.push_back(slab);
+        for (size_t i = slabSize; i-- > 0;) {
+            m_free = new (slab + i * stride) FreeBlock{m_free};
+        }
+    }
+
+    std::mutex m_mutex;
+    FreeBlock *m_free = nullptr;
+    // kept only so leak checkers see the blocks in use as reachable
+    std::vector<char *> m_slabs;
+};
+
+// For std::allocate_shared, which allocates the object and its reference
+// counts together as one block from the pool for that block's size.
+template <class T> struct PoolAllocator {
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template <class U> PoolAllocator(const PoolAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+        if (n != 1) return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+        return static_cast<T *>(SlabPool<sizeof(T), alignof(T)>::instance().allocate());
+    }
+
+    void deallocate(T *p, size_t n) {
+        if (n != 1) {
+            ::operator delete(p, std::align_val_t(alignof(T)));
+            return;
+        }
+        SlabPool<sizeof(T), alignof(T)>::instance().release(p);
+    }
+
+    template <class U> bool operator==(const PoolAllocator<U> &) const { return true; }
+    template <class U> bool operator!=(const PoolAllocator<U> &) const { return false; }
+};
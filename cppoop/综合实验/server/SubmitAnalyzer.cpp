@@ -0,0 +1,23 @@
+#include "SubmitAnalyzer.h"
+#include <algorithm>
+#include <cmath>
+
+void SubmitAnalyzer::record(int latencyMs, int wordLength) {
+    int msPerChar = std::max(latencyMs, 0) / std::max(wordLength, 1);
+    int bin = 0;
+    while (bin < binCount - 1 && (1 << bin) <= msPerChar) bin++;
+    m_histogram[bin]++;
+
+    m_count++;
+    double x = std::log2(msPerChar + 1.0);
+    double delta = x - m_mean;
+    m_mean += delta / m_count;
+    m_m2 += delta * (x - m_mean);
+
+    if (m_suspicious || m_count < minSamples) return;
+    uint32_t tooFast = 0;
+    for (int i = 0; i < humanFloorBin; i++) tooFast += m_histogram[i];
+    double deviation = std::sqrt(m_m2 / (m_count - 1));
+    m_suspicious = tooFast * 2 > m_count
+                || (m_count >= minSamplesForDeviation && deviation < minDeviation);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+// Streaming check of one session's answer times. Keeps a histogram of
+// milliseconds per character in power-of-two bins plus the running mean and
+// variance of its logarithm, so memory is constant and a submit costs a few
+// arithmetic operations. Once a session looks automated it stays flagged.
+class SubmitAnalyzer {
+  public:
+    // latency is measured from when the client lets the player type
+    void record(int latencyMs, int wordLength);
+    bool suspicious() const { return m_suspicious; }
+
+  private:
+    static constexpr int binCount = 16;
+    static constexpr int minSamples = 5;
+    static constexpr int minSamplesForDeviation = 10;
+    // bins below this are faster than anyone can react and type (< 64 ms/char)
+    static constexpr int humanFloorBin = 7;
+    // humans vary a lot between words; scripted clients barely vary at all.
+    // In log2 units, so 0.05 is about 3.5%.
+    static constexpr double minDeviation = 0.05;
+
+    std::array<uint32_t, binCount> m_histogram{};
+    uint32_t m_count = 0;
+    double m_mean = 0, m_m2 = 0;
+    bool m_suspicious = false;
+};
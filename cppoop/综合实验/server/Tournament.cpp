@@ -0,0 +1,306 @@
+#include "Tournament.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+TournamentSystem tournaments;
+
+static std::string joinTabs(const std::vector<std::string> &fields) {
+    std::string line;
+    for (size_t i = 0; i < fields.size(); i++) {
+        if (i) line += '\t';
+        line += fields[i];
+    }
+    return line;
+}
+
+// unlike getline, keeps empty fields, so "a\t" is two
+static std::vector<std::string> splitTabs(const std::string &line) {
+    std::vector<std::string> fields;
+    size_t begin = 0;
+    for (;;) {
+        size_t end = line.find('\t', begin);
+        fields.push_back(line.substr(begin, end - begin));
+        if (end == std::string::npos) return fields;
+        begin = end + 1;
+    }
+}
+
+const std::string &Tournament::getWinner() const {
+    static const std::string none;
+    return m_state == TournamentState::finished ? m_rounds.back()[0] : none;
+}
+
+bool Tournament::join(const std::string &name) {
+    if (m_state != TournamentState::open || std::count(m_players.begin(), m_players.end(), name)) {
+        return false;
+    }
+    m_players.push_back(name);
+    return true;
+}
+
+bool Tournament::start(const std::function<double(const std::string &)> &seedKey) {
+    if (m_state != TournamentState::open || m_players.size() < 2) {
+        return false;
+    }
+    std::vector<std::pair<double, std::string>> keyed;
+    for (const auto &name : m_players) {
+        keyed.push_back({-seedKey(name), name});
+    }
+    std::sort(keyed.begin(), keyed.end());
+    for (size_t i = 0; i < keyed.size(); i++) {
+        m_players[i] = keyed[i].second;
+    }
+
+    // Seed 1 meets seed 2 only in the final: each doubling of the bracket
+    // puts seed s against seed 2n + 1 - s, keeping s where it was.
+    std::vector<size_t> order{1};
+    while (order.size() < m_players.size()) {
+        std::vector<size_t> next;
+        for (size_t seed : order) {
+            next.push_back(seed);
+            next.push_back(order.size() * 2 + 1 - seed);
+        }
+        order = next;
+    }
+    m_rounds.clear();
+    m_rounds.emplace_back();
+    for (size_t seed : order) {
+        m_rounds[0].push_back(seed <= m_players.size() ? m_players[seed - 1] : "");
+    }
+    for (size_t size = order.size() / 2; size >= 1; size /= 2) {
+        m_rounds.emplace_back(size);
+    }
+    m_state = TournamentState::running;
+
+    // byes go to the top seeds, never against each other
+    for (size_t i = 0; i < m_rounds[1].size(); i++) {
+        if (m_rounds[0][2 * i + 1].empty()) {
+            decide(i, m_rounds[0][2 * i]);
+        }
+    }
+    return true;
+}
+
+size_t Tournament::currentRound() const {
+    for (size_t round = 0; round + 1 < m_rounds.size(); round++) {
+        const auto &next = m_rounds[round + 1];
+        if (std::find(next.begin(), next.end(), "") != next.end()) {
+            return round;
+        }
+    }
+    return m_rounds.size() - 1;
+}
+
+int Tournament::seedOf(const std::string &name) const {
+    return std::find(m_players.begin(), m_players.end(), name) - m_players.begin() + 1;
+}
+
+std::string Tournament::opponentOf(const std::string &name) const {
+    if (m_state != TournamentState::running) return "";
+    size_t round = currentRound();
+    const auto &players = m_rounds[round];
+    auto it = std::find(players.begin(), players.end(), name);
+    if (it == players.end()) return "";
+    size_t position = it - players.begin();
+    if (!m_rounds[round + 1][position / 2].empty()) return "";
+    return players[position ^ 1];
+}
+
+void Tournament::beginMatch(const std::string &name) {
+    const auto &players = m_rounds[currentRound()];
+    m_playing.insert((std::find(players.begin(), players.end(), name) - players.begin()) / 2);
+}
+
+bool Tournament::report(const std::string &player1, const std::string &player2, int winner) {
+    if (opponentOf(player1) != player2) return false;
+    size_t round = currentRound();
+    const auto &players = m_rounds[round];
+    size_t match = (std::find(players.begin(), players.end(), player1) - players.begin()) / 2;
+    if (winner == 0) {
+        winner = seedOf(player1) < seedOf(player2) ? 1 : 2;
+    }
+    decide(match, winner == 1 ? player1 : player2);
+    return currentRound() != round;
+}
+
+void Tournament::closeRound() {
+    if (m_state != TournamentState::running) return;
+    size_t round = currentRound();
+    const auto &players = m_rounds[round];
+    for (size_t i = 0; i < m_rounds[round + 1].size(); i++) {
+        if (!m_rounds[round + 1][i].empty() || m_playing.count(i)) continue;
+        const std::string &a = players[2 * i], &b = players[2 * i + 1];
+        bool presentA = m_present.count(a), presentB = m_present.count(b);
+        if (presentA != presentB) {
+            decide(i, presentA ? a : b);
+        } else {
+            decide(i, seedOf(a) < seedOf(b) ? a : b);
+        }
+    }
+}
+
+void Tournament::decide(size_t match, const std::string &winner) {
+    size_t round = currentRound();
+    m_rounds[round + 1][match] = winner;
+    m_playing.erase(match);
+    if (currentRound() != round) {
+        m_present.clear();
+        m_playing.clear();
+        if (currentRound() == m_rounds.size() - 1) {
+            m_state = TournamentState::finished;
+        }
+    }
+}
+
+std::string Tournament::getInfo() const {
+    size_t round = m_state == TournamentState::open ? 0 : currentRound() + 1;
+    std::string info = std::to_string((int)m_state) + " " + std::to_string(round) + "\n";
+    if (m_state == TournamentState::open) {
+        return info + "1\n" + joinTabs(m_players) + "\n";
+    }
+    info += std::to_string(m_rounds.size()) + "\n";
+    for (const auto &players : m_rounds) {
+        info += joinTabs(players) + "\n";
+    }
+    return info;
+}
+
+std::string Tournament::serialize() const {
+    std::string str = std::to_string(m_id) + "\t" + std::to_string((int)m_state) + "\t" + std::to_string(m_seedBy) + "\t" + m_title + "\n";
+    str += joinTabs(m_players) + "\n";
+    str += std::to_string(m_rounds.size()) + "\n";
+    for (const auto &players : m_rounds) {
+        str += joinTabs(players) + "\n";
+    }
+    return str;
+}
+
+std::unique_ptr<Tournament> Tournament::deserialize(std::istream &is) {
+    std::string line;
+    if (!std::getline(is, line)) return nullptr;
+    auto fields = splitTabs(line);
+    if (fields.size() != 4) return nullptr;
+    std::unique_ptr<Tournament> tournament;
+    int state, roundCount;
+    try {
+        tournament = std::make_unique<Tournament>(std::stoi(fields[0]), fields[3], std::stoi(fields[2]));
+        state = std::stoi(fields[1]);
+        std::getline(is, line);
+        if (!line.empty()) tournament->m_players = splitTabs(line);
+        std::getline(is, line);
+        roundCount = std::stoi(line);
+    } catch (const std::logic_error &) {
+        return nullptr;
+    }
+    if (state < 0 || state > (int)TournamentState::finished || roundCount < 0 || roundCount > 32) {
+        return nullptr;
+    }
+    tournament->m_state = (TournamentState)state;
+    for (int i = 0; i < roundCount && std::getline(is, line); i++) {
+        tournament->m_rounds.push_back(splitTabs(line));
+    }
+    // every round after the first is half the one before, down to the winner
+    if (tournament->m_state != TournamentState::open) {
+        auto &rounds = tournament->m_rounds;
+        if (rounds.size() < 2 || (int)rounds.size() != roundCount || rounds.back().size() != 1) return nullptr;
+        for (size_t i = 1; i < rounds.size(); i++) {
+            if (rounds[i - 1].size() != rounds[i].size() * 2) return nullptr;
+        }
+        if ((tournament->m_state == TournamentState::finished) != (tournament->currentRound() == rounds.size() - 1)) {
+            return nullptr;
+        }
+    }
+    return tournament;
+}
+
+void TournamentSystem::start(asio::io_context &ioContext, std::chrono::seconds roundTime) {
+    m_ioContext = &ioContext;
+    m_roundTime = roundTime;
+    load();
+    for (const auto &[_, tournament] : m_tournaments) {
+        if (tournament->getState() == TournamentState::running) {
+            roundStarted(*tournament);
+        }
+    }
+}
+
+Tournament *TournamentSystem::create(const std::string &title, int seedBy) {
+    int id = m_tournaments.empty() ? 1 : m_tournaments.rbegin()->first + 1;
+    auto &tournament = m_tournaments[id];
+    tournament = std::make_unique<Tournament>(id, title, seedBy);
+    return tournament.get();
+}
+
+Tournament *TournamentSystem::get(int id) {
+    auto it = m_tournaments.find(id);
+    return it == m_tournaments.end() ? nullptr : it->second.get();
+}
+
+std::string TournamentSystem::getListForClient() const {
+    std::string list = "tournament_list_res\n" + std::to_string(m_tournaments.size()) + "\n";
+    for (const auto &[id, tournament] : m_tournaments) {
+        list += std::to_string(id) + " " + std::to_string((int)tournament->getState()) + " "
+              + std::to_string(tournament->getPlayerCount()) + "\n"
+              + tournament->getTitle() + "\n";
+    }
+    return list;
+}
+
+// A timer on the I/O thread per running tournament rather than a thread;
+// replacing it cancels the wait for the round before.
+void TournamentSystem::roundStarted(Tournament &tournament) {
+    int id = tournament.getId();
+    if (tournament.getState() != TournamentState::running) {
+        m_deadlines.erase(id);
+        return;
+    }
+    auto &timer = m_deadlines[id];
+    timer = std::make_unique<asio::steady_timer>(*m_ioContext, m_roundTime);
+    timer->async_wait([this, id](const asio::error_code &ec) {
+        if (ec) return;
+        auto tournament = get(id);
+        if (tournament == nullptr) return;
+        std::cout << "closing round of tournament " << id << std::endl;
+        tournament->closeRound();
+        save();
+        // matches still being played finish the round when they end
+        roundStarted(*tournament);
+    });
+}
+
+void TournamentSystem::report(int id, const std::string &player1, const std::string &player2, int winner) {
+    auto tournament = get(id);
+    if (tournament == nullptr) return;
+    if (tournament->report(player1, player2, winner)) {
+        roundStarted(*tournament);
+    }
+    save();
+}
+
+void TournamentSystem::save() const {
+    std::ofstream os("tournaments.tsv.tmp");
+    for (const auto &[_, tournament] : m_tournaments) {
+        os << tournament->serialize();
+    }
+    os.close();
+    std::error_code ec;
+    std::filesystem::rename("tournaments.tsv.tmp", "tournaments.tsv", ec);
+    if (ec) {
+        std::cout << "failed to save tournaments: " << ec.message() << std::endl;
+    }
+}
+
+void TournamentSystem::load() {
+    m_tournaments.clear();
+    std::ifstream is("tournaments.tsv");
+    // stops at the first damaged entry, the ones after cannot be told apart
+    while (auto tournament = Tournament::deserialize(is)) {
+        int id = tournament->getId();
+        m_tournaments[id] = std::move(tournament);
+    }
+    std::cout << "loaded " + std::to_string(m_tournaments.size()) + " tournament(s)" << std::endl;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include "asio.hpp"
+#include <chrono>
+#include <functional>
+#include <istream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+enum class TournamentState { open, running, finished };
+
+// A single-elimination bracket. Players register while it is open; start()
+// seeds them so the best meet last, with byes for the top seeds when the
+// count is not a power of two. Each round's matches are played as ordinary
+// battles, in any order, and the next round begins when all are decided.
+class Tournament {
+  public:
+    // seedBy 0 for rating, 1 for level
+    Tournament(int id, const std::string &title, int seedBy) : m_id(id), m_title(title), m_seedBy(seedBy) {}
+
+    int getId() const { return m_id; }
+    const std::string &getTitle() const { return m_title; }
+    int getSeedBy() const { return m_seedBy; }
+    TournamentState getState() const { return m_state; }
+    size_t getPlayerCount() const { return m_players.size(); }
+    const std::string &getWinner() const;
+
+    bool join(const std::string &name);
+    // seedKey(name) is higher for stronger players; false if fewer than 2
+    // players have joined or it has already started
+    bool start(const std::function<double(const std::string &)> &seedKey);
+
+    // the opponent in name's undecided match of the current round, empty if
+    // there is none
+    std::string opponentOf(const std::string &name) const;
+    void checkIn(const std::string &name) { m_present.insert(name); }
+    void beginMatch(const std::string &name);
+    // winner is 1 or 2 for player1 or player2, 0 for a draw, which the
+    // higher seed goes through on. True if it finished the round.
+    bool report(const std::string &player1, const std::string &player2, int winner);
+    // Decides the matches of the round that are not being played: a player
+    // who checked in beats one who did not, otherwise the higher seed wins.
+    void closeRound();
+
+    std::string getInfo() const;
+    std::string serialize() const;
+    // reads what serialize() wrote, nullptr at the end of is
+    static std::unique_ptr<Tournament> deserialize(std::istream &is);
+
+  private:
+    // the round being played, m_rounds.size() - 1 when finished
+    size_t currentRound() const;
+    int seedOf(const std::string &name) const;
+    // the player of match in the current round who goes through
+    void decide(size_t match, const std::string &winner);
+
+    int m_id;
+    std::string m_title;
+    int m_seedBy;
+    TournamentState m_state = TournamentState::open;
+    // in seed order once started, the strongest first
+    std::vector<std::string> m_players;
+    // m_rounds[r] holds the players of round r in bracket order, match i
+    // being 2i against 2i+1; empty for a bye in round 0, or for a match of
+    // the round before that is not decided yet
+    std::vector<std::vector<std::string>> m_rounds;
+    // the current round, not saved
+    std::set<std::string> m_present;
+    std::set<size_t> m_playing;
+};
+
+// All tournaments, kept in tournaments.tsv. Rounds are timed on the I/O
+// thread: when one runs past roundTime its remaining matches are closed.
+class TournamentSystem {
+  public:
+    void start(asio::io_context &ioContext, std::chrono::seconds roundTime);
+
+    Tournament *create(const std::string &title, int seedBy);
+    Tournament *get(int id);
+    std::string getListForClient() const;
+
+    // called after a tournament starts or moves on to a new round
+    void roundStarted(Tournament &tournament);
+    // the end of a battle between two of the tournament's players, see
+    // Tournament::report
+    void report(int id, const std::string &player1, const std::string &player2, int winner);
+    void save() const;
+
+  private:
+    void load();
+
+    asio::io_context *m_ioContext = nullptr;
+    std::chrono::seconds m_roundTime{0};
+    std::map<int, std::unique_ptr<Tournament>> m_tournaments;
+    std::map<int, std::unique_ptr<asio::steady_timer>> m_deadlines;
+};
+
+extern TournamentSystem tournaments;
@@ -0,0 +1,252 @@
+#include "WordTrie.h"
+#include <algorithm>
+#include <iterator>
+
+// Daciuk's construction from sorted words: the states of the word before are
+// kept apart until the next word leaves them, then frozen. A frozen state is
+// replaced by an equal one frozen before, if there is one; frozen finds those
+// by hashing the edges in place.
+std::shared_ptr<const WordTrie::Graph> WordTrie::Graph::build(const std::vector<std::string_view> &words) {
+    auto graph = std::make_shared<Graph>();
+    std::vector<Edge> &edges = graph->edges;
+    edges.resize(1);
+    graph->size = words.size();
+    auto hash = [&edges](uint32_t state) {
+        size_t h = 0;
+        for (uint32_t edge = state;; edge++) {
+            h = h * 1000003 + ((size_t)edges[edge].target << 9 | (size_t)edges[edge].label << 1 | edges[edge].terminal);
+            if (edges[edge].last) return h ^ h >> 29;
+        }
+    };
+    auto equal = [&edges](uint32_t a, uint32_t b) {
+        for (;; a++, b++) {
+            if (edges[a].target != edges[b].target || edges[a].label != edges[b].label
+                || edges[a].terminal != edges[b].terminal || edges[a].last != edges[b].last) {
+                return false;
+            }
+            if (edges[a].last) return true;
+        }
+    };
+    // open addressing, 0 for a free slot; kept at most half full
+    std::vector<uint32_t> frozen(1024);
+    size_t frozenCount = 0;
+    auto find = [&](uint32_t state) -> uint32_t & {
+        size_t mask = frozen.size() - 1;
+        for (size_t i = hash(state) & mask;; i = (i + 1) & mask) {
+            if (!frozen[i] || equal(frozen[i], state)) return frozen[i];
+        }
+    };
+    // open[d] holds the edges out of the state at depth d on the last word,
+    // up to top; the last of them leads to open[d + 1]
+    std::vector<std::vector<Edge>> open(1);
+    size_t top = 0;
+    auto freeze = [&](std::vector<Edge> &out) -> uint32_t {
+        if (out.empty()) return 0;
+        out.back().last = true;
+        // added at the end, and taken off again if there is an equal state
+        uint32_t state = (uint32_t)edges.size();
+        edges.insert(edges.end(), out.begin(), out.end());
+        out.clear();
+        uint32_t &slot = find(state);
+        if (slot) {
+            edges.resize(state);
+            return slot;
+        }
+        slot = state;
+        if (++frozenCount * 2 > frozen.size()) {
+            std::vector<uint32_t> states;
+            states.swap(frozen);
+            frozen.resize(states.size() * 2);
+            for (uint32_t frozenState : states) {
+                if (frozenState) find(frozenState) = frozenState;
+            }
+        }
+        return state;
+    };
+    auto freezeBelow = [&](size_t depth) {
+        while (top > depth) {
+            uint32_t state = freeze(open[top]);
+            top--;
+            open[top].back().target = state;
+        }
+    };
+    std::string_view previous;
+    for (auto word : words) {
+        size_t common = 0;
+        while (common < previous.size() && common < word.size() && previous[common] == word[common]) {
+            common++;
+        }
+        freezeBelow(common);
+        for (size_t i = common; i < word.size(); i++) {
+            Edge edge;
+            edge.label = (unsigned char)word[i];
+            edge.terminal = i + 1 == word.size();
+            open[top].push_back(edge);
+            if (++top == open.size()) open.emplace_back();
+        }
+        previous = word;
+    }
+    freezeBelow(0);
+    graph->root = freeze(open[0]);
+    edges.shrink_to_fit();
+    return graph;
+}
+
+uint32_t WordTrie::Graph::find(uint32_t state, unsigned char c) const {
+    for (uint32_t edge = state; edge; edge = edges[edge].last ? 0 : edge + 1) {
+        if (edges[edge].label >= c) {
+            return edges[edge].label == c ? edge : 0;
+        }
+    }
+    return 0;
+}
+
+uint32_t WordTrie::Graph::walk(std::string_view word) const {
+    uint32_t state = root, edge = 0;
+    for (unsigned char c : word) {
+        edge = find(state, c);
+        if (!edge) return 0;
+        state = edges[edge].target;
+    }
+    return edge;
+}
+
+// Depth first without recursion: path holds the edge taken at each depth
+// below state, and edge is the next one to take at the current depth.
+void WordTrie::Graph::collect(uint32_t state, std::string word, size_t limit, std::vector<std::string> &words) const {
+    std::vector<uint32_t> path;
+    uint32_t edge = state;
+    while (words.size() < limit) {
+        if (edge) {
+            word.push_back((char)edges[edge].label);
+            if (edges[edge].terminal) {
+                words.push_back(word);
+            }
+            path.push_back(edge);
+            edge = edges[edge].target;
+        } else if (!path.empty()) {
+            edge = edges[path.back()].last ? 0 : path.back() + 1;
+            path.pop_back();
+            word.pop_back();
+        } else {
+            break;
+        }
+    }
+}
+
+bool WordTrie::insert(std::string_view word) {
+    return insert(std::vector<std::string_view>{word}) == 1;
+}
+
+size_t WordTrie::insert(std::vector<std::string_view> words) {
+    words.erase(std::remove_if(words.begin(), words.end(),
+                               [this](std::string_view word) {
+                                   return word.empty() || word.size() > maxWordLength || contains(word);
+                               }),
+                words.end());
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    if (words.empty()) {
+        return 0;
+    }
+    m_graphs.push_back(Graph::build(words));
+    merge();
+    return words.size();
+}
+
+// Merges the last graph into the one before while that one is at most twice
+// as big, so a word is rebuilt O(log n) times in all.
+void WordTrie::merge() {
+    while (m_graphs.size() >= 2 && m_graphs[m_graphs.size() - 2]->size <= 2 * m_graphs.back()->size) {
+        std::vector<std::string> first, second, words;
+        const Graph &a = *m_graphs[m_graphs.size() - 2], &b = *m_graphs.back();
+        a.collect(a.root, "", a.size, first);
+        b.collect(b.root, "", b.size, second);
+        words.reserve(first.size() + second.size());
+        std::merge(first.begin(), first.end(), second.begin(), second.end(), std::back_inserter(words));
+        m_graphs.pop_back();
+        m_graphs.back() = Graph::build(std::vector<std::string_view>(words.begin(), words.end()));
+    }
+}
+
+bool WordTrie::contains(std::string_view word) const {
+    for (const auto &graph : m_graphs) {
+        uint32_t edge = graph->walk(word);
+        if (edge && graph->edges[edge].terminal) return true;
+    }
+    return false;
+}
+
+size_t WordTrie::size() const {
+    size_t size = 0;
+    for (const auto &graph : m_graphs) {
+        size += graph->size;
+    }
+    return size;
+}
+
+std::vector<std::string> WordTrie::withPrefix(std::string_view prefix, size_t limit) const {
+    std::vector<std::string> words;
+    for (const auto &graph : m_graphs) {
+        uint32_t state = graph->root;
+        std::vector<std::string> found;
+        if (!prefix.empty()) {
+            uint32_t edge = graph->walk(prefix);
+            if (!edge) continue;
+            if (graph->edges[edge].terminal) found.emplace_back(prefix);
+            state = graph->edges[edge].target;
+        }
+        graph->collect(state, std::string(prefix), limit, found);
+        // each graph's words are in order and no word is in two of them
+        size_t middle = words.size();
+        words.insert(words.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+        std::inplace_merge(words.begin(), words.begin() + middle, words.end());
+        if (words.size() > limit) words.resize(limit);
+    }
+    return words;
+}
+
+// Levenshtein distance computed one level at a time: rows[d] is the row of
+// the table for the d-character prefix on the current path, so words sharing
+// a prefix share its rows.
+std::string WordTrie::findWithin(std::string_view word, int maxDistance, size_t minLength) const {
+    std::vector<std::vector<int>> rows(1, std::vector<int>(word.size() + 1));
+    for (size_t i = 0; i <= word.size(); i++) {
+        rows[0][i] = (int)i;
+    }
+    std::string path, best;
+    int bestDistance = maxDistance + 1;
+    for (const auto &graph : m_graphs) {
+        graph->search(graph->root, word, minLength, rows, path, best, bestDistance);
+    }
+    return best;
+}
+
+// Recursion is as deep as the longest word, which insert() bounds.
+void WordTrie::Graph::search(uint32_t state, std::string_view word, size_t minLength,
+                             std::vector<std::vector<int>> &rows, std::string &path, std::string &best,
+                             int &bestDistance) const {
+    if (rows.size() <= path.size() + 1) {
+        rows.emplace_back(word.size() + 1);
+    }
+    for (uint32_t edge = state; edge && bestDistance > 0; edge = edges[edge].last ? 0 : edge + 1) {
+        // rows may have grown, so index it again instead of keeping a row
+        const std::vector<int> &previous = rows[path.size()];
+        std::vector<int> &next = rows[path.size() + 1];
+        unsigned char c = edges[edge].label;
+        next[0] = previous[0] + 1;
+        for (size_t i = 1; i <= word.size(); i++) {
+            int substitute = previous[i - 1] + ((unsigned char)word[i - 1] != c);
+            next[i] = std::min({previous[i] + 1, next[i - 1] + 1, substitute});
+        }
+        path.push_back((char)c);
+        if (edges[edge].terminal && path.size() >= minLength && next[word.size()] < bestDistance) {
+            best = path;
+            bestDistance = next[word.size()];
+        }
+        if (*std::min_element(next.begin(), next.end()) < bestDistance) {
+            search(edges[edge].target, word, minLength, rows, path, best, bestDistance);
+        }
+        path.pop_back();
+    }
+}
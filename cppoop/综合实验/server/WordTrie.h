@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Set of words as a few minimized tries (DAWGs): tries in which equal
+// subtrees are stored once, so common endings like -ing or -tion cost no
+// more than common prefixes. Each edge is 8 bytes and there are far fewer
+// edges than characters.
+//
+// A graph cannot be added to once built, so an insert builds a new one and
+// graphs of similar size are merged, as in a binary counter, which leaves
+// O(log n) of them. Graphs are shared between copies, so copying a WordTrie
+// for a new ProblemSet snapshot copies O(log n) pointers.
+class WordTrie {
+  public:
+    // longer words are not taken, which bounds the depth of searches
+    static constexpr size_t maxWordLength = 64;
+
+    // false if word was already in the set, empty or too long
+    bool insert(std::string_view word);
+    // as insert() for each word, but adds all of them as one graph; returns
+    // how many were added
+    size_t insert(std::vector<std::string_view> words);
+    bool contains(std::string_view word) const;
+    size_t size() const;
+
+    // up to limit words starting with prefix, in byte order
+    std::vector<std::string> withPrefix(std::string_view prefix, size_t limit) const;
+
+    // A word of at least minLength bytes at most maxDistance insertions,
+    // deletions or substitutions away from word, preferring the closest;
+    // empty if there is none. Branches already too far off are skipped.
+    std::string findWithin(std::string_view word, int maxDistance, size_t minLength = 0) const;
+
+  private:
+    // A state is the run of edges out of it, ending with one marked last,
+    // and is named by the index of its first edge; 0 is the state without
+    // edges. A word ends on an edge marked terminal.
+    struct Edge {
+        uint32_t target = 0;
+        unsigned char label = 0;
+        bool last = false;
+        bool terminal = false;
+    };
+
+    struct Graph {
+        std::vector<Edge> edges;
+        uint32_t root = 0;
+        size_t size = 0;
+
+        // words must be sorted, unique and not empty
+        static std::shared_ptr<const Graph> build(const std::vector<std::string_view> &words);
+        // the edge out of state labelled c, 0 if none
+        uint32_t find(uint32_t state, unsigned char c) const;
+        // the edge word ends on, 0 if none
+        uint32_t walk(std::string_view word) const;
+        void collect(uint32_t state, std::string word, size_t limit, std::vector<std::string> &words) const;
+        void search(uint32_t state, std::string_view word, size_t minLength, std::vector<std::vector<int>> &rows,
+                    std::string &path, std::string &best, int &bestDistance) const;
+    };
+
+    void merge();
+
+    std::vector<std::shared_ptr<const Graph>> m_graphs;
+};
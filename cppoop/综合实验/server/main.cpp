@@ -1,45 +1,97 @@
-#include "Database.h"
-#include "Session.h"
-#include "asio.hpp"
-#include <User.h>
-#include <iostream>
-#include <memory>
-
-using asio::ip::tcp;
-const short port = 1764; // yh's number
-
-class Server {
-  public:
-    Server(asio::io_context &io_context, short port)
-        : m_ioContext(io_context), m_acceptor(io_context, tcp::endpoint(tcp::v4(), port), false) {
-        do_accept();
-    }
-
-  private:
-    void do_accept() {
-        m_acceptor.async_accept([this](std::error_code ec, tcp::socket socket) {
-            if (ec) {
-                std::cout << "async_accept error: " << ec.message() << std::endl;
-            } else {
-                std::make_shared<Session>(m_ioContext, std::move(socket))->start();
-            }
-            do_accept();
-        });
-    }
-
-    asio::io_context &m_ioContext;
-    tcp::acceptor m_acceptor;
-};
-
-int main(int argc, char *argv[]) {
-    db.load();
-    try {
-        asio::io_context io_context;
-        Server s(io_context, port);
-        std::cout << "listening on port " << port << std::endl;
-        io_context.run();
-    } catch (std::exception &e) {
-        std::cerr << "Exception: " << e.what() << "\n";
-    }
-    return 0;
+#include "Database.h"
+#include "Session.h"
+#include "asio.hpp"
+#include <User.h>
+#include <iostream>
+#include <memory>
+#include <string>
+
+using asio::ip::tcp;
+const short defaultPort = 1764; // yh's number
+
+class Server {
+  public:
+    Server(asio::io_context &io_context, short port)
+        : m_ioContext(io_context), m_acceptor(io_context, tcp::endpoint(tcp::v4(), port), false) {
+        do_accept();
+    }
+
+#ifdef USE_TLS
+    void useTls(const std::string &certFile, const std::string &keyFile) {
+        m_tlsContext = std::make_unique<asio::ssl::context>(asio::ssl::context::tls_server);
+        m_tlsContext->set_options(asio::ssl::context::default_workarounds | asio::ssl::context::no_sslv2 |
+                                  asio::ssl::context::no_sslv3 | asio::ssl::context::no_tlsv1 |
+                                  asio::ssl::context::no_tlsv1_1);
+        m_tlsContext->use_certificate_chain_file(certFile);
+        m_tlsContext->use_private_key_file(keyFile, asio::ssl::context::pem);
+    }
+#endif
+
+  private:
+    void do_accept() {
+        m_acceptor.async_accept([this](std::error_code ec, tcp::socket socket) {
+            if (ec) {
+                std::cout << "async_accept error: " << ec.message() << std::endl;
+            } else {
+                asio::error_code noDelayError;
+                socket.set_option(tcp::no_delay(true), noDelayError);
+                std::unique_ptr<Stream> stream;
+#ifdef USE_TLS
+                if (m_tlsContext) stream = std::make_unique<TlsStream>(std::move(socket), *m_tlsContext);
+#endif
+                if (!stream) stream = std::make_unique<TcpStream>(std::move(socket));
+                Session::create(m_ioContext, std::move(stream))->start();
+            }
+            do_accept();
+        });
+    }
+
+    asio::io_context &m_ioContext;
+    tcp::acceptor m_acceptor;
+#ifdef USE_TLS
+    std::unique_ptr<asio::ssl::context> m_tlsContext;
+#endif
+};
+
+// server [--port <port>] [--tls <certificate chain> <private key>] [--games <directory>]
+int main(int argc, char *argv[]) {
+    short port = defaultPort;
+    std::string certFile, keyFile, gamesDirectory;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--port" && i + 1 < argc) {
+            port = (short)std::stoi(argv[++i]);
+        } else if (arg == "--tls" && i + 2 < argc) {
+            certFile = argv[++i];
+            keyFile = argv[++i];
+        } else if (arg == "--games" && i + 1 < argc) {
+            gamesDirectory = argv[++i];
+        }
+    }
+
+    db.load();
+    db.startDifficultyUpdater(std::chrono::seconds(60));
+    db.startProblemReviewer();
+    if (!gamesDirectory.empty()) {
+        db.setGameStore(std::make_unique<FileGameStore>(gamesDirectory));
+    }
+    db.startGameCheckpointer(std::chrono::seconds(2));
+    try {
+        asio::io_context io_context;
+        tournaments.start(io_context, std::chrono::minutes(10));
+        db.startRatingUpdater(std::chrono::seconds(300), [&io_context](std::function<void()> f) {
+            asio::post(io_context, f);
+        });
+        Server s(io_context, port);
+#ifdef USE_TLS
+        if (!certFile.empty()) {
+            s.useTls(certFile, keyFile);
+        }
+#endif
+        std::cout << "listening on port " << port << std::endl;
+        io_context.run();
+    } catch (std::exception &e) {
+        std::cerr << "Exception: " << e.what() << "\n";
+    }
+    return 0;
 }
\ No newline at end of file
@@ -0,0 +1,167 @@
+// Fuzz target for the server's message handlers and its load path.
+//
+// The first byte of an input picks what the rest is:
+//   'U' users.tsv, 'P' problems.tsv, 'T' tournaments.tsv, read by load()
+//   anything else, the bytes a client sends: '\0'-terminated messages
+// Messages go through a Session on a stream with no socket under it, and
+// the session is led back out to the login screen afterwards, so inputs
+// do not leave it matching or in a battle.
+//
+// Built with libFuzzer when the compiler has it. Otherwise main() below
+// replays the files and directories given, which is how ctest runs the
+// seed corpus under the sanitizers.
+#include "Database.h"
+#include "Session.h"
+#include "Tournament.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+namespace {
+
+class FuzzStream : public Stream {
+  public:
+    FuzzStream(asio::io_context &ioContext, std::string input) : m_ioContext(ioContext), m_input(std::move(input)) {}
+
+    void async_handshake(std::function<void(std::error_code)> handler) override {
+        asio::post(m_ioContext, [handler] { handler({}); });
+    }
+
+    void async_read_until(asio::streambuf &buf, char delim, Handler handler) override {
+        size_t end = m_input.find(delim, m_offset);
+        if (end == std::string::npos) {
+            asio::post(m_ioContext, [handler] { handler(std::make_error_code(std::errc::connection_reset), 0); });
+            return;
+        }
+        size_t n = end + 1 - m_offset;
+        std::ostream(&buf).write(m_input.data() + m_offset, n);
+        m_offset += n;
+        asio::post(m_ioContext, [handler, n] { handler({}, n); });
+    }
+
+    void async_read_exactly(asio::streambuf &buf, std::size_t n, Handler handler) override {
+        n = std::min(n, m_input.size() - m_offset);
+        std::ostream(&buf).write(m_input.data() + m_offset, n);
+        m_offset += n;
+        asio::post(m_ioContext, [handler, n] { handler({}, n); });
+    }
+
+    void async_write(asio::const_buffer buffer, Handler handler) override {
+        size_t n = buffer.size();
+        asio::post(m_ioContext, [handler, n] { handler({}, n); });
+    }
+
+    void connect(const asio::ip::tcp::resolver::results_type &, const std::string &) override {}
+    std::size_t read_until(asio::streambuf &, char) override { return 0; }
+    std::size_t read_exactly(asio::streambuf &, std::size_t) override { return 0; }
+    void write(asio::const_buffer) override {}
+    void close() override {}
+
+  private:
+    asio::io_context &m_ioContext;
+    std::string m_input;
+    size_t m_offset = 0;
+};
+
+// never destroyed: sessions still waiting on it at exit would be torn down
+// after the globals they use
+asio::io_context &ioContext() {
+    static asio::io_context *ioContext = new asio::io_context;
+    return *ioContext;
+}
+
+void setUp() {
+    // the database saves after most messages, keep that out of the way
+    auto dir = std::filesystem::temp_directory_path() / "session_fuzzer";
+    std::filesystem::create_directories(dir);
+    std::filesystem::current_path(dir);
+    std::cout.rdbuf(nullptr);
+}
+
+void writeFile(const char *path, const uint8_t *data, size_t size) {
+    std::ofstream(path, std::ios::binary).write((const char *)data, size);
+}
+
+// Runs what is ready, including reviews of made problems and the writing of
+// game checkpoints, which would be on threads of their own in the server.
+// Timers are left pending.
+void settle() {
+    do {
+        ioContext().restart();
+        ioContext().poll();
+    } while (db.runQueuedReviews() > 0);
+    db.flushGames();
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static bool initialized = (setUp(), true);
+    (void)initialized;
+
+    for (const char *path : {"users.tsv", "problems.tsv", "tournaments.tsv"}) {
+        std::remove(path);
+    }
+    std::error_code ec;
+    std::filesystem::remove_all("games", ec);
+    char kind = size ? data[0] : 0;
+    if (kind == 'U' || kind == 'P') {
+        writeFile(kind == 'U' ? "users.tsv" : "problems.tsv", data + 1, size - 1);
+        db.load();
+        db.queryUsers(UserQuery());
+        return 0;
+    }
+    if (kind == 'T') {
+        writeFile("tournaments.tsv", data + 1, size - 1);
+    }
+    tournaments.start(ioContext(), std::chrono::minutes(10));
+    if (kind == 'T') {
+        std::string name;
+        for (int id = 1; id < 4; id++) {
+            if (auto tournament = tournaments.get(id)) {
+                tournament->getInfo();
+                tournament->opponentOf(name);
+                tournament->closeRound();
+                name = tournament->getWinner();
+            }
+        }
+        return 0;
+    }
+
+    db.load();
+    std::string input((const char *)data, size);
+    input.append("exit\0stop_match\0exit\0logout\0", 29);
+    auto session = Session::create(ioContext(), std::make_unique<FuzzStream>(ioContext(), std::move(input)));
+    session->start();
+    session.reset();
+    settle();
+    return 0;
+}
+
+#ifndef FUZZING_ENGINE
+int main(int argc, char *argv[]) {
+    // made absolute first, the target changes directory
+    std::vector<std::filesystem::path> paths;
+    for (int i = 1; i < argc; i++) {
+        std::filesystem::path path = std::filesystem::absolute(argv[i]);
+        if (std::filesystem::is_directory(path)) {
+            for (const auto &entry : std::filesystem::directory_iterator(path)) {
+                paths.push_back(entry.path());
+            }
+        } else {
+            paths.push_back(path);
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    for (const auto &path : paths) {
+        std::ifstream is(path, std::ios::binary);
+        std::string input((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+        LLVMFuzzerTestOneInput((const uint8_t *)input.data(), input.size());
+    }
+    std::fprintf(stderr, "ran %d input(s)\n", (int)paths.size());
+    return paths.empty() ? 1 : 0;
+}
+#endif